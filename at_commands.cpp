@@ -3,37 +3,54 @@
 #include "state_machine.h"
 #include "config.h"
 #include "comm_manager.h"
+#include "mipsend.h"
+#include "at_engine.h"
+#include "dtu_tx.h"
 #include <Arduino.h>
 
+// 连接流程各步的命令经 AT 引擎发送，应答/超时回调到 comm_on_at_result（ctx 为操作类型）
+// 引擎队列满时提交失败：仍进入该步，由 comm_on_at_rejected 退避后重新提交，连接流程不会停在原地
 void startATPing() {
-  sendCmd("AT");
+  bool ok = at_submit("AT", nullptr, AT_TIMEOUT_MS, comm_on_at_result, (void*)COMM_AT_PING);
   gotoStep(STEP_AT_PING);
+  if (!ok) comm_on_at_rejected(COMM_AT_PING);
 }
 
 void queryCEREG() {
-  sendCmd("AT+CEREG?");
+  bool ok = at_submit("AT+CEREG?", "+CEREG", REG_TIMEOUT_MS, comm_on_at_result, (void*)COMM_AT_CEREG);
   gotoStep(STEP_CEREG);
+  if (!ok) comm_on_at_rejected(COMM_AT_CEREG);
 }
 
+// 发送编码按 mipsend 当前模式：0=原始字节（二进制提示符模式），1=HEX；接收均为原始
 void setEncoding() {
-  sendCmd("AT+MIPCFG=\"encoding\",0,1,0");
+  const char* cmd = (mipsend_get_mode() == MIPSEND_MODE_BINARY)
+                      ? "AT+MIPCFG=\"encoding\",0,0,0"
+                      : "AT+MIPCFG=\"encoding\",0,1,0";
+  bool ok = at_submit(cmd, nullptr, AT_TIMEOUT_MS, comm_on_at_result, (void*)COMM_AT_ENCODING);
   gotoStep(STEP_ENCODING);
+  if (!ok) comm_on_at_rejected(COMM_AT_ENCODING);
 }
 
 void closeCh0() {
-  sendCmd("AT+MIPCLOSE=0");
+  bool ok = at_submit("AT+MIPCLOSE=0", "+MIPCLOSE", AT_TIMEOUT_MS, comm_on_at_result, (void*)COMM_AT_CLOSE);
   gotoStep(STEP_MIPCLOSE);
+  if (!ok) comm_on_at_rejected(COMM_AT_CLOSE);
 }
 
+// +MIPOPEN: ch,code 在 OK 之后到达，收到后才算完成
 void openTCP() {
   char buf[128];
   snprintf(buf, sizeof(buf), "AT+MIPOPEN=0,\"TCP\",\"%s\",%d", SERVER_IP, SERVER_PORT);
-  sendCmd(buf);
+  bool ok = at_submit(buf, "+MIPOPEN", OPEN_TIMEOUT_MS, comm_on_at_result, (void*)COMM_AT_OPEN,
+                      AT_F_INFO_AFTER_OK);
   gotoStep(STEP_MIPOPEN);
+  if (!ok) comm_on_at_rejected(COMM_AT_OPEN);
 }
 
+// 周期查询：提交失败等下一个轮询周期
 void pollMIPSTATE() {
-  sendCmd("AT+MIPSTATE=0");
+  (void)at_submit("AT+MIPSTATE=0", "+MIPSTATE", AT_TIMEOUT_MS, comm_on_at_result, (void*)COMM_AT_STATE);
   scheduleStatePoll();
 }
 
@@ -41,6 +58,9 @@ void pollMIPSTATE() {
 void modem_soft_power_cycle() {
     // Try graceful shutdown via AT if module responsive
     // Many modules accept AT+CFUN=0 (rf off) and AT+CPWROFF (power off) or AT+QPOWD
+    // 由 init_task 调用：等发送任务发完当前包，避免命令插进 MIPSEND 数据
+    dtu_link_lock(DTU_LINK_WAIT_FOREVER);
+    comm_invalidate_modem_cache();
     sendCmd("AT+CFUN=0");
     delay(200);
     sendCmd("AT+CPWROFF");
@@ -52,6 +72,7 @@ void modem_soft_power_cycle() {
     // Bring it back up logically (if module supports)
     sendCmd("AT+CFUN=1");
     delay(500);
+    dtu_link_unlock();
 
     // Note: if hardware power pin exists, the main recovery routine toggles it.
 }
\ No newline at end of file
@@ -0,0 +1,128 @@
+#include "at_engine.h"
+#include "config.h"
+#include "uart_utils.h"
+#include "mipsend.h"
+#include "dtu_rx.h"
+
+struct AtReq {
+  char     cmd[AT_CMD_MAX];
+  char     expect[16];
+  uint32_t timeoutMs;
+  AtDoneFn done;
+  void*    ctx;
+  uint8_t  flags;
+};
+
+static AtReq    s_q[AT_QUEUE_LEN];
+static uint8_t  s_qHead = 0;
+static uint8_t  s_qCount = 0;
+
+// 在途命令
+static bool     s_active = false;
+static bool     s_hold = false;   // 等待发包期间不启动排队命令
+static AtReq    s_cur;
+static uint32_t s_sentMs = 0;
+static bool     s_gotOk = false;
+static bool     s_hasInfo = false;
+static char     s_info[AT_INFO_MAX];
+
+static void start_next();
+
+bool at_submit(const char* cmd, const char* expect, uint32_t timeoutMs,
+               AtDoneFn done, void* ctx, uint8_t flags) {
+  if (s_qCount >= AT_QUEUE_LEN) return false;
+  AtReq& r = s_q[(s_qHead + s_qCount) % AT_QUEUE_LEN];
+  strncpy(r.cmd, cmd, sizeof(r.cmd) - 1);
+  r.cmd[sizeof(r.cmd) - 1] = '\0';
+  r.expect[0] = '\0';
+  if (expect) {
+    strncpy(r.expect, expect, sizeof(r.expect) - 1);
+    r.expect[sizeof(r.expect) - 1] = '\0';
+  }
+  r.timeoutMs = timeoutMs;
+  r.done = done;
+  r.ctx = ctx;
+  r.flags = flags;
+  s_qCount++;
+  start_next();
+  return true;
+}
+
+static void start_next() {
+  if (s_active || s_hold || s_qCount == 0 || mipsend_busy()) return;
+  s_cur = s_q[s_qHead];
+  s_qHead = (uint8_t)((s_qHead + 1) % AT_QUEUE_LEN);
+  s_qCount--;
+  s_active = true;
+  s_gotOk = false;
+  s_hasInfo = false;
+  s_sentMs = millis();
+  sendCmd(s_cur.cmd);
+}
+
+// 结束在途命令：先清状态再回调（回调里可能提交新命令），最后发下一条
+static void finish(AtResult res) {
+  AtReq req = s_cur;
+  bool hasInfo = s_hasInfo;
+  s_active = false;
+  if (req.done) {
+    AtLine info;
+    bool ok = hasInfo && at_parse_line(s_info, &info);
+    req.done(res, ok ? &info : nullptr, req.ctx);
+  }
+  start_next();
+}
+
+static bool is_info_line(const AtLine& line) {
+  if (s_cur.flags & AT_F_INFO_DIGITS) {
+    return line.kind == AT_LINE_OTHER && line.len > 0 && isdigit((unsigned char)line.text[0]);
+  }
+  size_t n = strlen(s_cur.expect);
+  return n > 0 && line.len >= n && memcmp(line.text, s_cur.expect, n) == 0;
+}
+
+bool at_engine_on_line(const AtLine& line) {
+  if (!s_active) return false;
+  if (!s_hasInfo && is_info_line(line)) {
+    size_t n = line.len < sizeof(s_info) - 1 ? line.len : sizeof(s_info) - 1;
+    memcpy(s_info, line.text, n);
+    s_info[n] = '\0';
+    s_hasInfo = true;
+    if ((s_cur.flags & AT_F_INFO_AFTER_OK) && s_gotOk) finish(AT_RES_OK);
+    return true;
+  }
+  if (line.kind == AT_LINE_ERROR) {
+    finish(AT_RES_ERROR);
+    return true;
+  }
+  if (line.kind == AT_LINE_OK && !s_gotOk) {
+    s_gotOk = true;
+    if (!(s_cur.flags & AT_F_INFO_AFTER_OK) || s_hasInfo) finish(AT_RES_OK);
+    return true;
+  }
+  return false;
+}
+
+void at_engine_poll() {
+  if (s_active && millis() - s_sentMs > s_cur.timeoutMs) finish(AT_RES_TIMEOUT);
+  start_next();
+}
+
+bool at_engine_busy() {
+  return s_active || s_qCount > 0;
+}
+
+void at_engine_wait_idle() {
+  s_hold = true;
+  while (s_active) {
+    readDTU();
+    if (s_active && millis() - s_sentMs > s_cur.timeoutMs) finish(AT_RES_TIMEOUT);
+    else if (s_active) dtu_rx_wait(10);
+  }
+  s_hold = false;
+}
+
+void at_engine_flush() {
+  s_qHead = 0;
+  s_qCount = 0;
+}
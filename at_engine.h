@@ -0,0 +1,39 @@
+#pragma once
+#include <Arduino.h>
+#include "at_parser.h"
+
+// 非阻塞AT命令引擎：命令排队，逐条发送；每条带期望的信息行前缀、超时和完成回调
+// 应答行由 comm_manager 的行分发先交给引擎，未被消费的行（URC）再交给连接状态机
+// 与 mipsend 互斥：包发送期间不发新命令，发送前等待在途命令完成
+
+enum AtResult : uint8_t {
+  AT_RES_OK = 0,     // 收到 OK（需要信息行时，已收到信息行）
+  AT_RES_ERROR,      // 收到 ERROR / +CME ERROR
+  AT_RES_TIMEOUT,
+};
+
+// 选项
+#define AT_F_INFO_AFTER_OK  0x01  // 信息行在 OK 之后以URC形式到达（如 +MIPOPEN），收到信息行才算完成
+#define AT_F_INFO_DIGITS    0x02  // 信息行是无前缀的纯数字行（如 AT+CIMI）
+
+// 完成回调：info 为捕获到的信息行（无则为 nullptr），仅在回调内有效；回调内可继续提交命令
+typedef void (*AtDoneFn)(AtResult res, const AtLine* info, void* ctx);
+
+// 提交命令；队列满返回 false。expect 为信息行前缀（如 "+CSQ"），可为 nullptr
+bool at_submit(const char* cmd, const char* expect, uint32_t timeoutMs,
+               AtDoneFn done, void* ctx = nullptr, uint8_t flags = 0);
+
+// 行钩子：属于在途命令的应答返回 true（已消费）
+bool at_engine_on_line(const AtLine& line);
+
+// 超时检查与发送下一条，主循环中调用
+void at_engine_poll();
+
+// 有在途或排队的命令
+bool at_engine_busy();
+
+// 等待在途命令完成（期间继续读取串口），供 mipsend 在发包前调用
+void at_engine_wait_idle();
+
+// 丢弃排队中的命令（不回调）；在途命令照常等待完成或超时
+void at_engine_flush();
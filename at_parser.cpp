@@ -0,0 +1,123 @@
+#include "at_parser.h"
+
+static inline bool is_space(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+// p 处是否以 tok 开头，且其后为行尾或 ':' / ' '（避免 +MIPSENDX 之类误匹配）
+static bool match(const char* p, const char* end, const char* tok) {
+  while (*tok) {
+    if (p >= end || *p != *tok) return false;
+    ++p; ++tok;
+  }
+  return p == end || *p == ':' || *p == ' ';
+}
+
+// 按前缀分支：'+' 后先看首字母，再比对剩余部分；每行最多比较一两个候选
+static AtLineKind classify(const char* p, const char* end) {
+  switch (p[0]) {
+    case 'O':
+      return match(p, end, "OK") ? AT_LINE_OK : AT_LINE_OTHER;
+    case 'E':
+      return match(p, end, "ERROR") ? AT_LINE_ERROR : AT_LINE_OTHER;
+    case '+':
+      break;
+    default:
+      return AT_LINE_OTHER;
+  }
+  if (end - p < 3) return AT_LINE_OTHER;
+  const char* q = p + 1;
+  switch (q[0]) {
+    case 'C':
+      switch (q[1]) {
+        case 'E': return match(q, end, "CEREG") ? AT_LINE_CEREG : AT_LINE_OTHER;
+        case 'S': return match(q, end, "CSQ") ? AT_LINE_CSQ : AT_LINE_OTHER;
+        case 'M': return (match(q, end, "CME ERROR") || match(q, end, "CMS ERROR"))
+                         ? AT_LINE_ERROR : AT_LINE_OTHER;
+        default:  return AT_LINE_OTHER;
+      }
+    case 'M':
+      if (q[1] == 'A') return match(q, end, "MATREADY") ? AT_LINE_MATREADY : AT_LINE_OTHER;
+      if (q[1] == 'C') return match(q, end, "MCCID") ? AT_LINE_MCCID : AT_LINE_OTHER;
+      if (q[1] != 'I' || end - q < 4 || q[2] != 'P') return AT_LINE_OTHER;
+      switch (q[3]) {
+        case 'O': return match(q, end, "MIPOPEN") ? AT_LINE_MIPOPEN : AT_LINE_OTHER;
+        case 'C': return match(q, end, "MIPCLOSE") ? AT_LINE_MIPCLOSE : AT_LINE_OTHER;
+        case 'U': return match(q, end, "MIPURC") ? AT_LINE_MIPURC : AT_LINE_OTHER;
+        case 'S':
+          if (end - q < 5) return AT_LINE_OTHER;
+          if (q[4] == 'T') return match(q, end, "MIPSTATE") ? AT_LINE_MIPSTATE : AT_LINE_OTHER;
+          if (q[4] == 'E') return match(q, end, "MIPSEND") ? AT_LINE_MIPSEND : AT_LINE_OTHER;
+          return AT_LINE_OTHER;
+        default:  return AT_LINE_OTHER;
+      }
+    default:
+      return AT_LINE_OTHER;
+  }
+}
+
+// 拆分冒号后的参数：逗号分隔，引号内的逗号不拆；纯整数字段同时给出数值
+static void split_fields(const char* p, const char* end, AtLine* out) {
+  out->nfield = 0;
+  while (p < end && out->nfield < AT_MAX_FIELDS) {
+    while (p < end && *p == ' ') ++p;
+    AtField& f = out->field[out->nfield++];
+    const char* s = p;
+    const char* e;
+    if (p < end && *p == '"') {
+      s = ++p;
+      while (p < end && *p != '"') ++p;
+      e = p;
+      if (p < end) ++p;  // 跳过闭引号
+      while (p < end && *p != ',') ++p;
+    } else {
+      while (p < end && *p != ',') ++p;
+      e = p;
+      while (e > s && e[-1] == ' ') --e;
+    }
+    f.s = s;
+    f.len = (uint8_t)((e - s) > 255 ? 255 : (e - s));
+    // 十进制整数（可带符号，至多9位；ICCID 之类长数字串只作文本）
+    const char* d = s;
+    bool neg = false;
+    if (d < e && (*d == '-' || *d == '+')) { neg = (*d == '-'); ++d; }
+    int32_t v = 0;
+    f.isNum = (d < e) && (e - d) <= 9;
+    for (; f.isNum && d < e; ++d) {
+      if (*d < '0' || *d > '9') { f.isNum = false; break; }
+      v = v * 10 + (*d - '0');
+    }
+    f.num = f.isNum ? (neg ? -v : v) : 0;
+    if (p < end) ++p;  // 跳过逗号
+  }
+}
+
+bool at_parse_line(const char* line, AtLine* out) {
+  const char* p = line;
+  while (is_space(*p)) ++p;
+  const char* end = p + strlen(p);
+  while (end > p && is_space(end[-1])) --end;
+
+  out->text = p;
+  out->len = (uint16_t)(end - p);
+  out->nfield = 0;
+  if (p == end) {
+    out->kind = AT_LINE_OTHER;
+    return false;
+  }
+  out->kind = classify(p, end);
+  if (out->kind != AT_LINE_OTHER && out->kind != AT_LINE_OK) {
+    const char* c = (const char*)memchr(p, ':', (size_t)(end - p));
+    if (c) split_fields(c + 1, end, out);
+  }
+  return true;
+}
+
+int32_t at_field_int(const AtLine& l, uint8_t i, int32_t def) {
+  if (i >= l.nfield || !l.field[i].isNum) return def;
+  return l.field[i].num;
+}
+
+bool at_field_is(const AtLine& l, uint8_t i, const char* s) {
+  if (i >= l.nfield) return false;
+  size_t n = strlen(s);
+  return l.field[i].len == n && memcmp(l.field[i].s, s, n) == 0;
+}
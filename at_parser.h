@@ -0,0 +1,45 @@
+#pragma once
+#include <Arduino.h>
+
+// AT应答/URC行分类：按前缀逐字符分支，一遍扫描完成分类和字段提取，不分配内存
+// 字段直接指向原行缓冲（AtLine 只在行处理函数内有效）
+
+enum AtLineKind : uint8_t {
+  AT_LINE_OTHER = 0,   // 未识别（如 AT+CIMI 的纯数字行、回显）
+  AT_LINE_OK,
+  AT_LINE_ERROR,       // ERROR / +CME ERROR / +CMS ERROR
+  AT_LINE_MATREADY,    // +MATREADY
+  AT_LINE_CEREG,       // +CEREG: n,stat
+  AT_LINE_CSQ,         // +CSQ: rssi,ber
+  AT_LINE_MCCID,       // +MCCID: iccid
+  AT_LINE_MIPOPEN,     // +MIPOPEN: ch,code
+  AT_LINE_MIPCLOSE,    // +MIPCLOSE: ch
+  AT_LINE_MIPSTATE,    // +MIPSTATE: ch,"TCP","ip",port,"STATE"
+  AT_LINE_MIPSEND,     // +MIPSEND: ch,len
+  AT_LINE_MIPURC,      // +MIPURC: "type",ch,...
+};
+
+#define AT_MAX_FIELDS 8
+
+struct AtField {
+  const char* s;   // 字段文本（引号已去掉），不以 '\0' 结尾
+  uint8_t  len;
+  bool     isNum;  // 整个字段为十进制整数
+  int32_t  num;
+};
+
+struct AtLine {
+  AtLineKind  kind;
+  const char* text;     // 去掉首尾空白后的行
+  uint16_t    len;
+  uint8_t     nfield;   // 冒号后逗号分隔的字段数
+  AtField     field[AT_MAX_FIELDS];
+};
+
+// 分类一行；空行返回 false
+bool at_parse_line(const char* line, AtLine* out);
+
+// 第 i 个字段的整数值（不存在或非数字返回 def）
+int32_t at_field_int(const AtLine& l, uint8_t i, int32_t def = -1);
+// 第 i 个字段是否等于 s（引号已去掉，大小写敏感）
+bool at_field_is(const AtLine& l, uint8_t i, const char* s);
@@ -3,7 +3,13 @@
 #include "uart_utils.h"
 #include "at_commands.h"
 #include "platform_packet.h"
+#include "mipsend.h"
+#include "at_parser.h"
+#include "dtu_tx.h"
+#include "dtu_baud.h"
+#include "link_stats.h"
 #include <Arduino.h>
+#include "esp_system.h"
 
 // ================== 通信状态机内部变量 ==================
 static Step step = STEP_IDLE;
@@ -12,14 +18,34 @@ static uint32_t nextStatePollMs = 0;
 static uint32_t backoffMs = 2000;
 static uint32_t lastHeartbeatMs = 0;
 static bool tcpConnected = false;
+// 模组拒绝过二进制发送（编码配置失败或提示符超时），本次运行内不再尝试
+static bool binaryRejected = false;
+
+// 模组状态缓存：模组不重启时编码配置一直有效，注册状态在有效期内可信，
+// 通道状态来自 MIPOPEN/MIPCLOSE 应答与断链事件。重新建链时按缓存跳过已满足的步骤
+enum SockState : uint8_t { SOCK_UNKNOWN = 0, SOCK_CLOSED, SOCK_OPEN };
+struct ModemCache {
+    bool        alive;          // AT 握手成功后为 true；握手失败或模组重启时作废全部
+    bool        encodingSet;    // 已按 encodingMode 配置 MIPCFG encoding
+    MipSendMode encodingMode;
+    bool        registered;
+    uint32_t    regMs;          // 最近一次确认已注册的时间
+    SockState   sock;
+};
+static ModemCache modem = {};
+static CommBringUpStats bringUpStats;
 
 // === 定时请求时间同步相关变量 ===
 static uint32_t lastTimeSyncReqMs = 0;
 
-// ================== 工具函数 ==================
-static String trimLine(const char* s) { String t = s; t.trim(); return t; }
-static bool lineHas(const char* line, const char* token) { return (strstr(line, token) != nullptr); }
+// === 非阻塞退避：到期后在 comm_drive 中执行重试动作 ===
+typedef void (*RetryFn)();
+static RetryFn retryFn = nullptr;
+static uint32_t retryAtMs = 0;
+static uint8_t stepRetries = 0;        // 当前步已重试次数（换步清零）
+static CommRetryStats retryStats;
 
+// ================== 工具函数 ==================
 void scheduleStatePoll() { nextStatePollMs = millis() + STATE_POLL_MS; }
 void comm_resetBackoff() { backoffMs = 2000; }
 
@@ -30,207 +56,352 @@ static void growBackoff() {
 }
 
 void comm_gotoStep(Step s) {
+    if (s != step) stepRetries = 0;
+    link_stats_on_step(step, s);
     step = s;
     actionStartMs = millis();
 }
 
+static uint8_t retryBudget(Step s) {
+    switch (s) {
+        case STEP_AT_PING: return RETRY_BUDGET_AT_PING;
+        case STEP_CEREG:   return RETRY_BUDGET_CEREG;
+        case STEP_MIPOPEN:
+        case STEP_MONITOR: return RETRY_BUDGET_MIPOPEN;
+        default:           return 0xFF;
+    }
+}
+
+void comm_invalidate_modem_cache() {
+    modem = ModemCache();
+}
+
+// 已建立的连接断开：通道已关闭，重连可直接 MIPOPEN
+static void linkDown() {
+    if (tcpConnected) link_stats_on_link_down();
+    tcpConnected = false;
+    modem.sock = SOCK_CLOSED;
+}
+
+// 重试预算用完：丢弃排队的AT命令，从头走一遍连接流程。
+// 反复失败说明注册/通道状态不可信，只保留编码配置（模组未重启时仍有效）
+static void restartBringUp() {
+    at_engine_flush();
+    if (tcpConnected) link_stats_on_link_down();
+    tcpConnected = false;
+    modem.alive = false;
+    modem.registered = false;
+    modem.sock = SOCK_UNKNOWN;
+    comm_gotoStep(STEP_IDLE);
+}
+
+// 退避后重试：等待时间取 [backoff/2, backoff] 内的随机值（等抖动），避免多台设备同步重连；
+// 不阻塞，到期由 comm_drive 执行 fn
+static void scheduleRetry(RetryFn fn) {
+    growBackoff();
+    uint32_t half = backoffMs / 2;
+    uint32_t wait = half + esp_random() % (half + 1);
+    retryStats.retries[step]++;
+    if (++stepRetries > retryBudget(step)) {
+        log2Val("[COMM] retry budget exhausted at step ", (int)step);
+        retryStats.budget_exhausted++;
+        fn = restartBringUp;
+    }
+    retryFn = fn;
+    retryAtMs = millis() + wait;
+    retryStats.last_backoff_ms = wait;
+}
+
+void comm_get_retry_stats(CommRetryStats& out) {
+    out = retryStats;
+    out.pending = retryFn != nullptr;
+}
+
+void comm_get_bringup_stats(CommBringUpStats& out) {
+    out = bringUpStats;
+}
+
+// 编码协商：优先二进制，被拒绝则回退HEX
+static MipSendMode preferredEncoding() {
+    return (DTU_SEND_BINARY_PREF && !binaryRejected) ? MIPSEND_MODE_BINARY : MIPSEND_MODE_HEX;
+}
+
+static void fallbackToHexEncoding() {
+    log2("Binary send rejected, fallback to HEX");
+    binaryRejected = true;
+    modem.encodingSet = false;
+    mipsend_set_mode(MIPSEND_MODE_HEX);
+    setEncoding();
+}
+
+// 打开通道：已知关闭则直接 MIPOPEN，否则先 MIPCLOSE
+static void openChannel() {
+    if (modem.sock == SOCK_CLOSED) {
+        bringUpStats.close_skipped++;
+        openTCP();
+    } else {
+        closeCh0();
+    }
+}
+
+// 从缓存判断建链还缺哪一步，直接从该步继续（开机、断链重连、各步完成后都经此推进）
+static void resumeBringUp() {
+    if (!modem.alive) {
+        bringUpStats.full++;
+        startATPing();
+        return;
+    }
+    if (!modem.registered || millis() - modem.regMs >= MODEM_REG_CACHE_MS) {
+        modem.registered = false;
+        queryCEREG();
+        return;
+    }
+    if (step != STEP_CEREG) bringUpStats.cereg_skipped++;
+    MipSendMode mode = preferredEncoding();
+    mipsend_set_mode(mode);
+    if (!modem.encodingSet || modem.encodingMode != mode) {
+        setEncoding();
+        return;
+    }
+    bringUpStats.encoding_skipped++;
+    openChannel();
+}
+
 // ================== 各状态处理函数 ==================
 static void handleStepIdle() {
     comm_gotoStep(STEP_WAIT_READY);
     actionStartMs = millis();
-    startATPing();
+    resumeBringUp();
 }
 
-static void handleStepWaitReady(const String& line) {
-    if (lineHas(line.c_str(), "+MATREADY")) {
-        startATPing();
-    }
+// 各命令完成后的状态推进（超时由AT引擎判定，不再在 comm_drive 中逐步计时）
+static void onBaudDone(bool) {
+    resumeBringUp();
 }
 
-static void handleStepAtPing(const String& line) {
-    if (lineHas(line.c_str(), "OK")) {
+static void onPingResult(AtResult res) {
+    if (res == AT_RES_OK) {
         comm_resetBackoff();
-        queryCEREG();
+        dtu_baud_on_ping_ok();
+        modem.alive = true;
+        // 首次握手成功后协商提速，完成后再继续连接流程
+        if (!dtu_baud_escalate(onBaudDone)) resumeBringUp();
+        return;
     }
+    // 无应答：模组可能重启过，缓存的配置不再可信
+    comm_invalidate_modem_cache();
+    dtu_baud_on_ping_fail();
+    scheduleRetry(startATPing);
 }
 
-static void handleStepCereg(const String& line) {
-    if (lineHas(line.c_str(), "+CEREG")) {
-        int stat = -1;
-        const char* p = strchr(line.c_str(), ',');
-        if (p) { stat = atoi(++p); }
-        if (stat == 1 || stat == 5) {
-            setEncoding();
-        }
+static void onCeregResult(AtResult res, const AtLine* info) {
+    int32_t stat = info ? at_field_int(*info, 1) : -1;
+    if (res == AT_RES_OK && (stat == 1 || stat == 5)) {
+        modem.registered = true;
+        modem.regMs = millis();
+        resumeBringUp();
+        return;
     }
+    // 未注册或无应答：退避后重查
+    modem.registered = false;
+    scheduleRetry(queryCEREG);
 }
 
-static void handleStepEncoding(const String& line) {
-    if (lineHas(line.c_str(), "OK") || lineHas(line.c_str(), "ERROR")) {
+static void onEncodingResult(AtResult res) {
+    if (res == AT_RES_OK) {
+        modem.encodingSet = true;
+        modem.encodingMode = mipsend_get_mode();
+        openChannel();
+    } else if (mipsend_get_mode() == MIPSEND_MODE_BINARY) {
+        fallbackToHexEncoding();
+    } else {
         closeCh0();
     }
 }
 
-static void handleStepMipclose(const String& line) {
-    if (lineHas(line.c_str(), "OK") || lineHas(line.c_str(), "+MIPCLOSE")) {
-        openTCP();
+static void onCloseResult() {
+    // 无论结果都重新打开（未打开的通道关闭时报错）
+    modem.sock = SOCK_CLOSED;
+    openTCP();
+}
+
+static void onOpenResult(AtResult res, const AtLine* info) {
+    if (res == AT_RES_OK && info && at_field_int(*info, 1) == 0) {
+        log2("TCP connected");
+        tcpConnected = true;
+        modem.sock = SOCK_OPEN;
+        modem.registered = true;
+        modem.regMs = millis();
+        comm_resetBackoff();
+        lastHeartbeatMs = millis();
+        lastTimeSyncReqMs = millis() - TIME_SYNC_INTERVAL_MS; // 立即触发
+        comm_gotoStep(STEP_MONITOR);
+        scheduleStatePoll();
+        return;
     }
+    if (res == AT_RES_OK) log2("TCP open failed");
+    else log2("TCP open ERROR");
+    tcpConnected = false;
+    scheduleRetry(openTCP);
 }
 
-static void handleStepMipopen(const String& line) {
-    if (lineHas(line.c_str(), "+MIPOPEN")) {
-        int ch = -1, code = -1;
-        const char* p = strstr(line.c_str(), "+MIPOPEN");
-        if (p) {
-            p = strchr(p, ':'); if (p) ++p;
-            while (*p == ' ') ++p;
-            ch = atoi(p);
-            p = strchr(p, ',');
-            if (p) { code = atoi(++p); }
-        }
+static void onStateResult(AtResult res, const AtLine* info) {
+    // 超时/出错或无状态行：等下次轮询
+    if (res != AT_RES_OK || !info || step != STEP_MONITOR) return;
+    // 最后一个字段为连接状态；"DISCONNECTED" 不再被子串匹配误判为已连接
+    if (info->nfield > 0 && at_field_is(*info, info->nfield - 1, "CONNECTED")) {
+        tcpConnected = true;
+        modem.regMs = millis();   // 连接正常即仍在网
+    } else {
+        log2("TCP disconnected");
+        linkDown();
+        scheduleRetry(resumeBringUp);
+    }
+}
 
-        if (code == 0) {
-            log2("TCP connected");
-            tcpConnected = true;
-            comm_resetBackoff();
-            lastHeartbeatMs = millis();
-            lastTimeSyncReqMs = millis() - TIME_SYNC_INTERVAL_MS; // 立即触发
-            comm_gotoStep(STEP_MONITOR);
-            scheduleStatePoll();
-        } else {
-            log2("TCP open failed");
-            tcpConnected = false;
-            growBackoff();
-            delay(backoffMs);
-            openTCP();
-        }
-    } else if (lineHas(line.c_str(), "ERROR")) {
-        log2("TCP open ERROR");
-        tcpConnected = false;
-        growBackoff();
-        delay(backoffMs);
-        openTCP();
+void comm_on_at_result(AtResult res, const AtLine* info, void* op) {
+    switch ((CommAtOp)(uintptr_t)op) {
+        case COMM_AT_PING:     onPingResult(res);           break;
+        case COMM_AT_CEREG:    onCeregResult(res, info);    break;
+        case COMM_AT_ENCODING: onEncodingResult(res);       break;
+        case COMM_AT_CLOSE:    onCloseResult();             break;
+        case COMM_AT_OPEN:     onOpenResult(res, info);     break;
+        case COMM_AT_STATE:    onStateResult(res, info);    break;
+        default: break;
     }
 }
 
-static void handleStepMonitor(const String& line) {
-    if (lineHas(line.c_str(), "+MIPSTATE")) {
-        if (strstr(line.c_str(), "CONNECTED")) {
-            tcpConnected = true;
-        } else {
-            log2("TCP disconnected");
-            tcpConnected = false;
-            growBackoff();
-            delay(backoffMs);
-            openTCP();
-        }
+void comm_on_at_rejected(CommAtOp op) {
+    log2Val("[COMM] AT submit rejected, op=", (int)op);
+    switch (op) {
+        case COMM_AT_PING:     scheduleRetry(startATPing); break;
+        case COMM_AT_CEREG:    scheduleRetry(queryCEREG);  break;
+        case COMM_AT_ENCODING: scheduleRetry(setEncoding); break;
+        case COMM_AT_CLOSE:    scheduleRetry(closeCh0);    break;
+        case COMM_AT_OPEN:     scheduleRetry(openTCP);     break;
+        default: break;
     }
 }
 
-static void handleDisconnEvent(const String& line) {
-    if (lineHas(line.c_str(), "+MIPURC") && lineHas(line.c_str(), "\"disconn\"")) {
-        tcpConnected = false;
+static bool isDisconnEvent(const AtLine& line) {
+    return line.kind == AT_LINE_MIPURC && at_field_is(line, 0, "disconn");
+}
+
+static void handleDisconnEvent(const AtLine& line) {
+    if (isDisconnEvent(line)) {
+        linkDown();
         log2("TCP disconnected");
-        growBackoff();
-        delay(backoffMs);
-        openTCP();
+        scheduleRetry(resumeBringUp);
     }
 }
 
 // 心跳仅与通信维护有关，保留在通信层
 static void sendHeartbeatIfNeeded(uint32_t now) {
+    // 入队失败（队列满）时不更新时间，下一轮再试
     if (tcpConnected && (now - lastHeartbeatMs >= HEARTBEAT_INTERVAL_MS)) {
-        sendHeartbeat();
-        lastHeartbeatMs = now;
+        if (sendHeartbeat()) lastHeartbeatMs = now;
     }
 }
 
 // 定时发送时间同步请求
 static void sendTimeSyncIfNeeded(uint32_t now) {
     if (tcpConnected && (now - lastTimeSyncReqMs >= TIME_SYNC_INTERVAL_MS)) {
-        sendTimeSyncRequest();
-        lastTimeSyncReqMs = now;
+        if (sendTimeSyncRequest()) lastTimeSyncReqMs = now;
     }
 }
 
 // 行分发（注册到 uart_utils，主要用于AT命令应答和事件）
 static void handleLine(const char* rawLine) {
-    String line = trimLine(rawLine);
-    if (line.length() == 0) return;
+    AtLine line;
+    if (!at_parse_line(rawLine, &line)) return;
 
-    // 断开事件
-    handleDisconnEvent(line);
+    // 包发送过程中（等待 '>' 时会分发收到的行）：只消费发送应答，
+    // 断链时中止本包，重连留到发送结束后的 comm_drive 中处理
+    if (mipsend_busy()) {
+        if (mipsend_on_line(line)) return;
+        if (isDisconnEvent(line)) {
+            linkDown();
+            mipsend_abort();
+        }
+        return;
+    }
+    if (mipsend_on_line(line)) return;
+    // 在途AT命令的应答
+    if (at_engine_on_line(line)) return;
 
-    switch (step) {
-        case STEP_WAIT_READY: handleStepWaitReady(line); break;
-        case STEP_AT_PING:    handleStepAtPing(line);    break;
-        case STEP_CEREG:      handleStepCereg(line);     break;
-        case STEP_ENCODING:   handleStepEncoding(line);  break;
-        case STEP_MIPCLOSE:   handleStepMipclose(line);  break;
-        case STEP_MIPOPEN:    handleStepMipopen(line);   break;
-        case STEP_MONITOR:    handleStepMonitor(line);   break;
-        default: break;
+    // 以下为URC
+    handleDisconnEvent(line);
+    if (line.kind == AT_LINE_MATREADY) {
+        // 模组（重新）启动：之前的配置与连接均已失效
+        comm_invalidate_modem_cache();
+        if (step == STEP_WAIT_READY) startATPing();
+        else if (tcpConnected) linkDown();   // 由监控态补做重连
+        modem.sock = SOCK_CLOSED;
     }
 }
 
 // 主循环：仅负责通信维持（AT/TCP/心跳/状态轮询/时间同步）
+// 各步的应答与超时由AT引擎回调推进，这里只驱动引擎和监控态的周期任务
+// 发送任务持有链路锁（正在发包）时跳过本轮，应答由发送任务读取
 void comm_drive() {
+    if (!dtu_link_lock()) return;
     uint32_t now = millis();
+    at_engine_poll();
+    dtu_baud_drive(now);
+
+    // 退避等待中：到期执行重试，期间不推进其它动作
+    if (retryFn) {
+        if ((int32_t)(now - retryAtMs) >= 0) {
+            RetryFn fn = retryFn;
+            retryFn = nullptr;
+            fn();
+        }
+        dtu_link_unlock();
+        return;
+    }
 
     switch (step) {
         case STEP_IDLE:
             handleStepIdle();
             break;
 
-        case STEP_AT_PING:
-            if (now - actionStartMs > AT_TIMEOUT_MS) {
-                growBackoff();
-                delay(backoffMs);
-                startATPing();
-            }
-            break;
-
-        case STEP_CEREG:
-            if (now - actionStartMs > REG_TIMEOUT_MS) {
-                growBackoff();
-                delay(backoffMs);
-                queryCEREG();
+        case STEP_MONITOR: {
+            // 包只发出一部分（流上有空洞或截断）：平台分帧已失步，关闭通道后重连
+            bool streamError = mipsend_take_stream_error();
+            // 二进制发送提示符超时：回退HEX，重新配置编码并重建连接
+            if (mipsend_take_link_error()) {
+                if (tcpConnected) link_stats_on_link_down();
+                tcpConnected = false;
+                modem.sock = SOCK_UNKNOWN;
+                fallbackToHexEncoding();
+                break;
             }
-            break;
-
-        case STEP_ENCODING:
-            if (now - actionStartMs > AT_TIMEOUT_MS) {
+            if (streamError && tcpConnected) {
+                log2("TCP stream out of sync, reopen");
+                link_stats_on_link_down();
+                tcpConnected = false;
+                modem.sock = SOCK_OPEN;
                 closeCh0();
+                break;
             }
-            break;
-
-        case STEP_MIPCLOSE:
-            if (now - actionStartMs > AT_TIMEOUT_MS) {
-                openTCP();
-            }
-            break;
-
-        case STEP_MIPOPEN:
-            if (now - actionStartMs > OPEN_TIMEOUT_MS) {
-                tcpConnected = false;
-                growBackoff();
-                delay(backoffMs);
-                openTCP();
+            // 发送过程中收到断链事件：此时补做重连
+            if (!tcpConnected) {
+                log2("TCP disconnected");
+                scheduleRetry(resumeBringUp);
+                break;
             }
-            break;
-
-        case STEP_MONITOR: {
             if (now > nextStatePollMs) {
                 pollMIPSTATE();
-                scheduleStatePoll();
             }
             sendHeartbeatIfNeeded(now);
             sendTimeSyncIfNeeded(now); // 定时请求时间同步
+            dtu_baud_check(now);       // 高速串口线路质量
             break;
         }
         default:
             break;
     }
+    dtu_link_unlock();
 }
 
 bool comm_isConnected() { return tcpConnected; }
@@ -2,6 +2,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "state_machine.h"
+#include "at_engine.h"
 
 // 通信管理对外接口
 void comm_gotoStep(Step s);
@@ -9,5 +10,41 @@ void comm_resetBackoff();
 void comm_drive();
 bool comm_isConnected();
 
+// 退避重试统计（retries 按发起重试时所在的步计数）
+struct CommRetryStats {
+    uint32_t retries[STEP_MONITOR + 1] = {0};
+    uint32_t budget_exhausted = 0;   // 某步重试预算用完、从头重走连接流程的次数
+    uint32_t last_backoff_ms = 0;    // 最近一次退避等待（含抖动）
+    bool     pending = false;        // 当前是否在退避等待中
+};
+void comm_get_retry_stats(CommRetryStats& out);
+
+// 建链路径统计：模组状态缓存有效时跳过的步骤
+struct CommBringUpStats {
+    uint32_t full = 0;           // 从 AT 握手开始
+    uint32_t cereg_skipped = 0;  // 注册状态仍有效，未查 CEREG
+    uint32_t encoding_skipped = 0;
+    uint32_t close_skipped = 0;  // 已知通道已关闭，直接 MIPOPEN
+};
+void comm_get_bringup_stats(CommBringUpStats& out);
+
+// 模组可能已重启或断电（软重启、电源复位）：作废缓存的编码/注册/通道状态
+void comm_invalidate_modem_cache();
+
 // 声明对外 scheduleStatePoll
-void scheduleStatePoll();
\ No newline at end of file
+void scheduleStatePoll();
+// 连接流程中各AT命令的操作类型（作为 at_submit 的 ctx）
+enum CommAtOp {
+    COMM_AT_PING = 1,
+    COMM_AT_CEREG,
+    COMM_AT_ENCODING,
+    COMM_AT_CLOSE,
+    COMM_AT_OPEN,
+    COMM_AT_STATE,
+};
+
+// AT 引擎完成回调：按操作类型推进连接状态机
+void comm_on_at_result(AtResult res, const AtLine* info, void* op);
+
+// 命令未能提交（引擎队列满）：退避后重新提交该步命令
+void comm_on_at_rejected(CommAtOp op);
@@ -22,6 +22,9 @@
 #define PLATFORM_DMODEL     0x1d
 #define CMD_HEARTBEAT_REQ   0x0000
 #define CMD_TIME_SYNC_REQ   0x0001
+#define CMD_REALTIME_DATA   0x1d00
+#define CMD_REALTIME_BATCH  0x1d01   // 实时数据批量上报（见 rt_batch.h）
+#define CMD_LINK_STATS_UP   0x0008   // 链路统计周期上报
 
 static char g_device_sn[13] = "000000065531";
 
@@ -32,13 +35,117 @@ static const uint32_t OPEN_TIMEOUT_MS      = 15000;
 static const uint32_t STATE_POLL_MS        = 10000;
 static const uint32_t HEARTBEAT_INTERVAL_MS = 60000;
 static const uint32_t BACKOFF_MAX_MS = 30000;
-static const uint32_t REALTIME_UPLOAD_INTERVAL_MS = 30000;
+// 各步连续重试预算，用完后从头重走连接流程（退避不阻塞，等待时间带随机抖动）
+static const uint8_t RETRY_BUDGET_AT_PING = 6;
+static const uint8_t RETRY_BUDGET_CEREG   = 20;   // 注册可能较慢
+static const uint8_t RETRY_BUDGET_MIPOPEN = 8;
+// 模组状态缓存：最近一次确认已注册（CEREG/TCP 建立/状态轮询）后的有效期，期内重连跳过 CEREG
+static const uint32_t MODEM_REG_CACHE_MS  = 120000;
+static const uint32_t REALTIME_UPLOAD_INTERVAL_MS = 30000;   // 采样周期
+// 实时数据批量上报（CMD_REALTIME_BATCH，需平台支持）：凑满条数或首条等待超时即发送，告警状态变化时立即发送
+// 1=逐条发送 0x1d00（默认）；平台支持批量包后可设为 10 左右
+#define REALTIME_BATCH_SIZE        1
+#define REALTIME_BATCH_MAX_AGE_MS  300000UL
 
 // RTC校时周期（10分钟）
 static const uint32_t TIME_SYNC_INTERVAL_MS = 600000; // 10min
 
 static const size_t LINE_BUF_MAX = 512;
 
+// AT命令引擎
+#define AT_QUEUE_LEN      8     // 排队命令数
+#define AT_CMD_MAX        96    // 单条命令最大长度
+#define AT_INFO_MAX       96    // 捕获的信息行最大长度
+#define SIM_QUERY_RETRY_MS 30000  // SIM信息采集失败后的重试间隔
+
+// 上行发送编码：1=优先协商二进制（提示符模式，省一半串口时间），失败自动回退HEX；0=始终HEX
+#ifndef DTU_SEND_BINARY_PREF
+#define DTU_SEND_BINARY_PREF 1
+#endif
+#define MIPSEND_RAW_CHUNK          512    // 二进制模式每次 AT+MIPSEND=0,<len> 的最大字节数
+#define MIPSEND_PROMPT_TIMEOUT_MS  2000   // 等待 '>' 提示符超时
+#define MIPSEND_WINDOW_MAX         4      // HEX 模式未确认 MIPSEND 的最大深度（槽内存 = 深度 × RAW_CHUNK）；提示符模式为 1
+#define MIPSEND_CHUNK_MIN          32     // 出错后块长下限
+#define MIPSEND_ACK_TIMEOUT_MS     3000   // 等不到任何应答则放弃本包
+
+// DTU串口接收：驱动事件回调搬运到大环形缓冲（0=退回主循环轮询 Serial）
+#ifndef DTU_RX_ASYNC
+#define DTU_RX_ASYNC 1
+#endif
+#define DTU_RX_DRIVER_BUF  4096    // 串口驱动接收缓冲（Serial.setRxBufferSize）
+#define DTU_RX_RING_SIZE   16384   // 接收环形缓冲（2的幂）
+#define DTU_RX_RING_SIZE_MIN 4096  // 内部RAM不足时的退路（2的幂）
+
+// DTU串口提速：首次AT握手成功后经 AT+IPR 协商到 DTU_BAUD_FAST，探测通过后记入NVS，
+// 之后开机直接以该速率启动；握手连续失败时在两档间切换，高速下线路错误过多则回落（0=关闭）
+#ifndef DTU_BAUD_FAST
+#define DTU_BAUD_FAST        921600
+#endif
+#define DTU_BAUD_SETTLE_MS   50      // 模组切换速率后的稳定时间
+#define DTU_BAUD_PROBE_TRIES 3       // 切换后探测 AT 的次数
+#define DTU_BAUD_PROBE_MS    500     // 单次探测超时
+#define DTU_BAUD_HUNT_FAILS  2       // 连续握手失败达到该次数后换另一档速率
+#define DTU_BAUD_CHECK_MS    10000   // 高速下线路质量检查周期
+#define DTU_BAUD_ERR_MAX     8       // 检查周期内帧错误超过该数则回落
+#define DTU_BAUD_TIMEOUT_MAX 2       // 检查周期内发送应答超时超过该数则回落
+
+// 链路统计：滚动窗口内的RTT/建链耗时/吞吐直方图，窗口结束时上报一次
+#define LINK_STATS_WINDOW_MS   3600000UL   // 1小时
+#define LINK_STATS_UPLOAD      1           // 0=只在本地统计
+
+// 上行确认窗口：包序号放在协议头 pid，平台以相同 cmd+pid 应答即确认；超时/重连后只重传未确认的包
+// 需平台应答回送上行 pid；平台支持前保持 0，否则每个包都会重传到上限
+#define UL_ACK_ENABLE        0       // 0=只带序号，不跟踪确认、不重传
+#define UL_ACK_WINDOW        8       // 同时在途（已发未确认）的可靠包上限，满则发送方背压
+#define UL_ACK_TIMEOUT_MS    15000   // 模组确认发出后等待平台应答的时间
+#define UL_ACK_RETRY_MAX     3       // 重传次数上限，超过则放弃（计入统计；作业包报告发送方）
+
+// 离线日志：断链期间的实时数据与事件顺序记入SD，重连后按批限速补传
+#define JOURNAL_ENABLE              1
+#define JOURNAL_PATH                "/journal.bin"
+#define JOURNAL_MAX_BYTES           (1024UL * 1024UL)   // 文件上限，满后丢弃新记录（计数）
+#define JOURNAL_REPLAY_BATCH        4                   // 每批至多补传的记录数
+#define JOURNAL_REPLAY_INTERVAL_MS  1000                // 批间隔
+
+// DTU上行发送任务：业务方把包描述入队即返回，由发送任务逐个交给 mipsend（0=在调用方同步发送）
+#ifndef DTU_TX_ASYNC
+#define DTU_TX_ASYNC 1
+#endif
+#define DTU_TX_TASK_STACK    6144
+#define DTU_TX_TASK_PRIO     2
+#define DTU_TX_INLINE_MAX    96      // 小包 payload 随描述拷贝入队的上限（链路统计 95 字节）
+#define DTU_TX_DEPTH_HIGH    4       // 心跳、校时、开机上报
+#define DTU_TX_DEPTH_NORMAL  8       // 实时数据、SIM信息
+#define DTU_TX_DEPTH_BULK    2       // 事件图片
+
+// 下行帧解码环形缓冲：PSRAM 中可容纳满长 payload（65535）；无PSRAM或分配失败时在内部RAM中退到 MIN（超长帧只校验不交付）
+#define DL_RING_SIZE      (65535 + 1)
+#define DL_RING_SIZE_MIN  2048
+#define DL_HEAD_TIMEOUT_MS   200   // 帧头23字节须在此时间内收齐
+#define DL_FRAME_TIMEOUT_MS  3000  // 帧体字节间最大停顿
+#define DL_DISPATCH_SLOTS    32    // 下行命令注册表槽数（2的幂）
+
+// 数据包跟踪（带外输出，不占用DTU串口）：0=编译期完全移除
+// sink: 0=无 1=Serial2 2=RAM环形缓冲 3=SD文件；mode: 0=关 1=仅头 2=抽样 3=完整
+#ifndef PKT_TRACE_ENABLE
+#define PKT_TRACE_ENABLE 1
+#endif
+#ifndef PKT_TRACE_DEFAULT_SINK
+#define PKT_TRACE_DEFAULT_SINK (ENABLE_LOG2 ? 1 : 2)
+#endif
+#ifndef PKT_TRACE_DEFAULT_MODE
+#define PKT_TRACE_DEFAULT_MODE 1
+#endif
+#define PKT_TRACE_SAMPLE_EVERY 16
+#define PKT_TRACE_RING_SIZE    2048
+#define PKT_TRACE_SD_PATH      "/pkttrace.log"
+#define PKT_TRACE_SD_MAX_BYTES (1024UL * 1024UL)
+
+// CRC16 实现选择：0=逐位（无表），1=单表（512B），4=slice-by-4（2KB），8=slice-by-8（4KB）
+#ifndef CRC16_IMPL
+#define CRC16_IMPL 4
+#endif
+
 extern volatile int g_monitorEventUploadFlag;
 
 #define SW_VER_HIGH  1
@@ -91,6 +198,34 @@ extern volatile int g_monitorEventUploadFlag;
 #endif
 // ===== 异步SD写与内存池 END =====
 
+// ===== 图片CRC旁路记录（写卡时计算，上传时直接使用） =====
+#ifndef PHOTO_SIDECAR_ENABLE
+#define PHOTO_SIDECAR_ENABLE 1
+#endif
+#ifndef PHOTO_SIDECAR_CRC32
+#define PHOTO_SIDECAR_CRC32  0   // 1=额外记录CRC32（ROM实现）
+#endif
+#ifndef PHOTO_SIDECAR_VERIFY
+#define PHOTO_SIDECAR_VERIFY 1   // 1=上传时顺带校验SD回读与记录一致（同一遍，不额外读）
+#endif
+
+// ===== SD图片流式上传（双缓冲预取） =====
+#ifndef PHOTO_STREAM_CHUNK
+#define PHOTO_STREAM_CHUNK 1024
+#endif
+#define PHOTO_STREAM_TASK_STACK       3072
+#define PHOTO_STREAM_TASK_PRIO        2
+#define PHOTO_STREAM_READ_TIMEOUT_MS  2000
+
+// ===== 大图分片上传（超过 PHOTO_SINGLE_MAX 的图片拆成多个 0x1d0a 包连续发送） =====
+#define CMD_EVENT_UPLOAD        0x1d09    // 单包事件上传（图片 ≤ PHOTO_SINGLE_MAX 或无图）
+#define CMD_EVENT_FRAG_UPLOAD   0x1d0a
+#define PHOTO_SINGLE_MAX        65000     // 单包附图上限（元数据20字节，整包 payload ≤ 65535）；超过即分片
+#define PHOTO_FRAG_SIZE         60000     // 每片图片字节数（片头30字节，整包 payload ≤ 65535）
+#define PHOTO_UPLOAD_MAX_BYTES  400000UL  // 超过则不附图（防止异常文件长时间占用链路）
+#define UPLOAD_TICK_BUDGET_US   5000      // upload_drive 单次调度耗时预算（超出计数）
+#define XFER_RESUME_REWIND      1         // 重启续传时回退一片（模组已确认、未送达的数据）；运行中由确认窗口按片重传
+
 // === 开关 ===
 #define UPGRADE_ENABLE 1
 
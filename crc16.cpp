@@ -1,7 +1,14 @@
 #include "crc16.h"
+#include "config.h"
 
-uint16_t crc16_modbus(const uint8_t* data, size_t len) {
-  uint16_t crc = 0xFFFF;
+// CRC16_IMPL 见 config.h：0=逐位，1=单表，4=slice-by-4，8=slice-by-8
+#if CRC16_IMPL != 0 && CRC16_IMPL != 1 && CRC16_IMPL != 4 && CRC16_IMPL != 8
+#error "CRC16_IMPL must be 0, 1, 4 or 8"
+#endif
+
+#if CRC16_IMPL == 0
+
+static inline uint16_t crc16_core(uint16_t crc, const uint8_t* data, size_t len) {
   for (size_t i = 0; i < len; ++i) {
     crc ^= (uint16_t)data[i];
     for (int j = 0; j < 8; ++j) {
@@ -10,4 +17,114 @@ uint16_t crc16_modbus(const uint8_t* data, size_t len) {
     }
   }
   return crc;
-}
\ No newline at end of file
+}
+
+#else
+
+// 查表放在 DRAM（首次使用时生成），避免 flash cache 未命中；
+// 表大小 = CRC16_IMPL * 512B（slice-by-4 为 2KB）
+static uint16_t s_tbl[CRC16_IMPL][256];
+static volatile bool s_tblReady = false;
+
+static void crc16_build_tables() {
+  for (int i = 0; i < 256; ++i) {
+    uint16_t c = (uint16_t)i;
+    for (int j = 0; j < 8; ++j) {
+      if (c & 0x0001) c = (c >> 1) ^ 0xA001;
+      else c >>= 1;
+    }
+    s_tbl[0][i] = c;
+  }
+  // s_tbl[k][v]：字节 v 之后再跟 k 个 0 字节的贡献
+  for (int k = 1; k < CRC16_IMPL; ++k) {
+    for (int i = 0; i < 256; ++i) {
+      uint16_t c = s_tbl[k - 1][i];
+      s_tbl[k][i] = (c >> 8) ^ s_tbl[0][c & 0xFF];
+    }
+  }
+  s_tblReady = true;  // 多任务并发首次调用时重复生成结果相同，无需加锁
+}
+
+static inline uint16_t crc16_core(uint16_t crc, const uint8_t* data, size_t len) {
+  if (!s_tblReady) crc16_build_tables();
+
+#if CRC16_IMPL >= 4
+  // 16位寄存器在前2字节即被完全“吃掉”，其余字节直接按位置查对应切片表
+  while (len >= CRC16_IMPL) {
+    uint16_t x = crc ^ (uint16_t)(data[0] | (data[1] << 8));
+#if CRC16_IMPL == 8
+    crc = s_tbl[7][x & 0xFF] ^ s_tbl[6][x >> 8] ^
+          s_tbl[5][data[2]]  ^ s_tbl[4][data[3]] ^
+          s_tbl[3][data[4]]  ^ s_tbl[2][data[5]] ^
+          s_tbl[1][data[6]]  ^ s_tbl[0][data[7]];
+#else
+    crc = s_tbl[3][x & 0xFF] ^ s_tbl[2][x >> 8] ^
+          s_tbl[1][data[2]]  ^ s_tbl[0][data[3]];
+#endif
+    data += CRC16_IMPL;
+    len  -= CRC16_IMPL;
+  }
+#endif
+
+  while (len--) {
+    crc = (crc >> 8) ^ s_tbl[0][(crc ^ *data++) & 0xFF];
+  }
+  return crc;
+}
+
+#endif
+
+uint16_t crc16_modbus(const uint8_t* data, size_t len) {
+  return crc16_core(0xFFFF, data, len);
+}
+
+void crc16_init(Crc16Ctx* ctx) {
+  ctx->crc = 0xFFFF;
+}
+
+void crc16_update(Crc16Ctx* ctx, const uint8_t* data, size_t len) {
+  if (!data || !len) return;
+  ctx->crc = crc16_core(ctx->crc, data, len);
+}
+
+uint16_t crc16_final(const Crc16Ctx* ctx) {
+  return ctx->crc;
+}
+
+// ---- CRC 拼接：crc(A||B) = M^lenB · (crc(A) ^ 0xFFFF) ^ crc(B)，M 为输入一个0字节的线性变换 ----
+static uint16_t gf2_times(const uint16_t* mat, uint16_t vec) {
+  uint16_t sum = 0;
+  while (vec) {
+    if (vec & 1) sum ^= *mat;
+    vec >>= 1;
+    mat++;
+  }
+  return sum;
+}
+
+static void gf2_square(uint16_t* sq, const uint16_t* mat) {
+  for (int n = 0; n < 16; ++n) sq[n] = gf2_times(mat, mat[n]);
+}
+
+uint16_t crc16_combine(uint16_t crcA, uint16_t crcB, uint32_t lenB) {
+  if (lenB == 0) return crcA;
+
+  uint16_t odd[16], even[16];
+  // 输入一个0比特的算子（LSB-first，多项式 0xA001）
+  odd[0] = 0xA001;
+  for (int n = 1; n < 16; ++n) odd[n] = (uint16_t)(1u << (n - 1));
+  gf2_square(even, odd);   // 2 比特
+  gf2_square(odd, even);   // 4 比特
+
+  uint16_t v = crcA ^ 0xFFFF;
+  do {
+    gf2_square(even, odd); // 首轮为 1 字节，之后逐次翻倍
+    if (lenB & 1) v = gf2_times(even, v);
+    lenB >>= 1;
+    if (!lenB) break;
+    gf2_square(odd, even);
+    if (lenB & 1) v = gf2_times(odd, v);
+    lenB >>= 1;
+  } while (lenB);
+  return v ^ crcB;
+}
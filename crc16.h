@@ -3,4 +3,18 @@
 #include <Arduino.h>
 
 // CRC-16/MODBUS (init 0xFFFF, poly 0xA001, LSB-first)
-uint16_t crc16_modbus(const uint8_t* data, size_t len);
\ No newline at end of file
+uint16_t crc16_modbus(const uint8_t* data, size_t len);
+
+// 流式计算上下文：init → update(多次) → final，结果与 crc16_modbus 逐位一致
+// 用于边发送边计算（数据分块到达，不需要整块驻留内存）
+typedef struct {
+    uint16_t crc;
+} Crc16Ctx;
+
+void     crc16_init(Crc16Ctx* ctx);
+void     crc16_update(Crc16Ctx* ctx, const uint8_t* data, size_t len);
+uint16_t crc16_final(const Crc16Ctx* ctx);
+
+// 由 crc(A)、crc(B) 与 B 的长度求 crc(A||B)，无需再遍历数据（GF(2) 矩阵幂，O(log lenB)）
+// 用于把预先算好的图片CRC与元数据段CRC拼成整包数据CRC
+uint16_t crc16_combine(uint16_t crcA, uint16_t crcB, uint32_t lenB);
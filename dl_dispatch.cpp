@@ -0,0 +1,91 @@
+#include "dl_dispatch.h"
+#include "config.h"
+
+// 表容量须为2的幂，且大于注册数（保留空槽保证查找终止）
+static_assert((DL_DISPATCH_SLOTS & (DL_DISPATCH_SLOTS - 1)) == 0, "DL_DISPATCH_SLOTS must be power of 2");
+
+enum SlotState : uint8_t { SLOT_EMPTY, SLOT_USED, SLOT_DELETED };
+
+struct Slot {
+  SlotState    state;
+  DlCmdHandler handler;
+  void*        ctx;
+  DlCmdStats   st;
+};
+
+static Slot s_slots[DL_DISPATCH_SLOTS];
+static size_t s_used = 0;
+static uint32_t s_unhandled = 0;
+
+static inline size_t hash_cmd(uint16_t cmd) {
+  // 乘法散列：cmd 常按高字节分组（0x00xx、0x1dxx），取乘积高位打散
+  return (size_t)(((uint32_t)cmd * 0x9E3779B1u) >> 16) & (DL_DISPATCH_SLOTS - 1);
+}
+
+static Slot* find(uint16_t cmd) {
+  size_t i = hash_cmd(cmd);
+  for (size_t n = 0; n < DL_DISPATCH_SLOTS; ++n) {
+    Slot& s = s_slots[i];
+    if (s.state == SLOT_EMPTY) return nullptr;
+    if (s.state == SLOT_USED && s.st.cmd == cmd) return &s;
+    i = (i + 1) & (DL_DISPATCH_SLOTS - 1);
+  }
+  return nullptr;
+}
+
+bool dl_dispatch_register(uint16_t cmd, DlCmdHandler h, void* ctx) {
+  if (!h) return false;
+  Slot* s = find(cmd);
+  if (s) {
+    s->handler = h;
+    s->ctx = ctx;
+    return true;
+  }
+  if (s_used + 1 >= DL_DISPATCH_SLOTS) return false;
+  size_t i = hash_cmd(cmd);
+  while (s_slots[i].state == SLOT_USED) i = (i + 1) & (DL_DISPATCH_SLOTS - 1);
+  Slot& n = s_slots[i];
+  n.state = SLOT_USED;
+  n.handler = h;
+  n.ctx = ctx;
+  n.st = DlCmdStats();
+  n.st.cmd = cmd;
+  s_used++;
+  return true;
+}
+
+bool dl_dispatch_unregister(uint16_t cmd) {
+  Slot* s = find(cmd);
+  if (!s) return false;
+  // 留墓碑，保证其后的探测链不断
+  s->state = SLOT_DELETED;
+  s->handler = nullptr;
+  s_used--;
+  return true;
+}
+
+void dl_dispatch_frame(const DlFrame* f) {
+  Slot* s = find(f->cmd);
+  if (!s) {
+    s_unhandled++;
+    return;
+  }
+  uint32_t t0 = micros();
+  s->handler(f, s->ctx);
+  uint32_t dt = micros() - t0;
+  s->st.count++;
+  s->st.total_us += dt;
+  if (dt > s->st.max_us) s->st.max_us = dt;
+}
+
+size_t dl_dispatch_get_stats(DlCmdStats* out, size_t maxCount) {
+  size_t n = 0;
+  for (size_t i = 0; i < DL_DISPATCH_SLOTS && n < maxCount; ++i) {
+    if (s_slots[i].state == SLOT_USED) out[n++] = s_slots[i].st;
+  }
+  return n;
+}
+
+uint32_t dl_dispatch_unhandled() {
+  return s_unhandled;
+}
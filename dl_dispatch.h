@@ -0,0 +1,28 @@
+#pragma once
+#include <Arduino.h>
+#include "dl_frame.h"
+
+// 下行命令分发：cmd → 处理函数，开放寻址哈希表，查找为常数时间
+// 新的下行功能（配置、拍照、升级等）只需注册处理函数，不改字节接收循环
+// 注册/注销须在初始化或与 readDTU 同一任务中进行
+
+typedef void (*DlCmdHandler)(const DlFrame* f, void* ctx);
+
+struct DlCmdStats {
+  uint16_t cmd = 0;
+  uint32_t count = 0;     // 调用次数
+  uint32_t total_us = 0;  // 处理函数累计耗时
+  uint32_t max_us = 0;    // 单次最大耗时
+};
+
+// 注册（同一 cmd 重复注册则替换处理函数并保留统计）；表满返回 false
+bool dl_dispatch_register(uint16_t cmd, DlCmdHandler h, void* ctx = nullptr);
+bool dl_dispatch_unregister(uint16_t cmd);
+
+// 分发一帧（作为 dl_frame 的帧处理函数）
+void dl_dispatch_frame(const DlFrame* f);
+
+// 导出各已注册命令的统计，返回条数
+size_t dl_dispatch_get_stats(DlCmdStats* out, size_t maxCount);
+// 未注册命令的帧数
+uint32_t dl_dispatch_unhandled();
@@ -0,0 +1,216 @@
+#include "dl_frame.h"
+#include "crc16.h"
+#include <esp_heap_caps.h>
+
+enum DlState : uint8_t {
+  ST_IDLE,   // 找 '$'
+  ST_HEAD,   // 收协议头 + 头CRC
+  ST_BODY,   // 收 payload
+  ST_DCRC,   // 收数据CRC
+};
+
+static DlState  s_state = ST_IDLE;
+static uint8_t  s_head[DL_FRAME_HEAD_LEN];
+static size_t   s_headLen = 0;
+static Crc16Ctx s_crc;            // 头CRC与数据CRC共用（依次计算）
+static uint16_t s_bodyLen = 0;
+static uint16_t s_bodyGot = 0;
+static uint8_t  s_dcrc[2];
+static uint8_t  s_dcrcLen = 0;
+static bool     s_store = false;  // payload 是否写入环形缓冲（超长帧只校验）
+static uint32_t s_lastByteMs = 0;
+
+static uint8_t* s_ring = nullptr;
+static size_t   s_ringSize = 0;
+static size_t   s_wr = 0;         // 环形缓冲写位置
+static size_t   s_bodyStart = 0;
+static bool     s_initTried = false;
+
+static DlFrameHandler s_handler = nullptr;
+static DlTextSink     s_text = nullptr;
+static DlFrameStats   s_st;
+
+bool dl_frame_init() {
+  if (s_ring) return true;
+  s_initTried = true;
+  // 满长帧需要约64KB：只从PSRAM分配；内部RAM与DTU接收环、发送任务栈、相机驱动共用，
+  // 不为偶发的长下行帧占用64KB，直接退到小缓冲
+  size_t sz = DL_RING_SIZE;
+  s_ring = (uint8_t*)heap_caps_malloc(sz, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  if (!s_ring) {
+    sz = DL_RING_SIZE_MIN;
+    s_ring = (uint8_t*)heap_caps_malloc(sz, MALLOC_CAP_8BIT);
+  }
+  s_ringSize = s_ring ? sz : 0;
+  s_st.ring_size = s_ringSize;
+  s_wr = 0;
+  return s_ring != nullptr;
+}
+
+void dl_frame_set_handler(DlFrameHandler h) { s_handler = h; }
+void dl_frame_set_text_sink(DlTextSink s) { s_text = s; }
+
+bool dl_frame_active() { return s_state != ST_IDLE; }
+
+size_t dl_frame_body_remaining() {
+  return s_state == ST_BODY ? (size_t)(s_bodyLen - s_bodyGot) : 0;
+}
+
+static void reset_frame() {
+  s_state = ST_IDLE;
+  s_headLen = 0;
+  s_dcrcLen = 0;
+}
+
+static void deliver() {
+  s_st.frames++;
+  if (!s_handler) return;
+  DlFrame f;
+  f.head = s_head;
+  f.opType = (char)s_head[1];
+  f.cmd = (uint16_t)((s_head[17] << 8) | s_head[18]);
+  f.pid = s_head[20];
+  f.len = s_bodyLen;
+  f.part[0] = f.part[1] = nullptr;
+  f.partLen[0] = f.partLen[1] = 0;
+  if (s_bodyLen) {
+    size_t first = s_ringSize - s_bodyStart;
+    if (first > s_bodyLen) first = s_bodyLen;
+    f.part[0] = s_ring + s_bodyStart;
+    f.partLen[0] = (uint16_t)first;
+    if (first < s_bodyLen) {
+      f.part[1] = s_ring;
+      f.partLen[1] = (uint16_t)(s_bodyLen - first);
+    }
+  }
+  s_handler(&f);
+}
+
+static void feed_byte(uint8_t c);
+
+// 头CRC错误：'$' 交给文本通道，其后的字节重新走一遍状态机（其中可能有真正的帧头）
+static void head_fail() {
+  s_st.head_crc_err++;
+  uint8_t tmp[DL_FRAME_HEAD_LEN];
+  size_t n = s_headLen;
+  memcpy(tmp, s_head, n);
+  reset_frame();
+  if (s_text) s_text(tmp[0]);
+  for (size_t i = 1; i < n; ++i) feed_byte(tmp[i]);
+}
+
+static void head_done() {
+  uint16_t want = (uint16_t)((s_head[DL_FRAME_HDR_LEN] << 8) | s_head[DL_FRAME_HDR_LEN + 1]);
+  if (crc16_final(&s_crc) != want) {
+    head_fail();
+    return;
+  }
+  s_bodyLen = (uint16_t)((s_head[2] << 8) | s_head[3]);
+  s_bodyGot = 0;
+  if (s_bodyLen > s_st.max_len) s_st.max_len = s_bodyLen;
+  if (s_bodyLen == 0) {
+    // 空 payload 无数据CRC
+    reset_frame();
+    deliver();
+    return;
+  }
+  s_store = (s_bodyLen <= s_ringSize);
+  if (!s_store) s_st.oversize++;
+  s_bodyStart = s_wr;
+  crc16_init(&s_crc);
+  s_state = ST_BODY;
+}
+
+// payload 整块处理：一次CRC更新 + 至多两次拷贝（回绕）
+static size_t body_chunk(const uint8_t* d, size_t n) {
+  size_t k = (size_t)(s_bodyLen - s_bodyGot);
+  if (k > n) k = n;
+  crc16_update(&s_crc, d, k);
+  if (s_store) {
+    size_t first = s_ringSize - s_wr;
+    if (first > k) first = k;
+    memcpy(s_ring + s_wr, d, first);
+    if (k > first) memcpy(s_ring, d + first, k - first);
+    s_wr = (s_wr + k) % s_ringSize;
+  }
+  s_bodyGot = (uint16_t)(s_bodyGot + k);
+  if (s_bodyGot == s_bodyLen) s_state = ST_DCRC;
+  return k;
+}
+
+static void feed_byte(uint8_t c) {
+  switch (s_state) {
+    case ST_IDLE:
+      if (c == '$') {
+        s_head[0] = c;
+        s_headLen = 1;
+        crc16_init(&s_crc);
+        crc16_update(&s_crc, &c, 1);
+        s_state = ST_HEAD;
+      } else if (s_text) {
+        s_text(c);
+      }
+      break;
+    case ST_HEAD:
+      s_head[s_headLen++] = c;
+      if (s_headLen <= DL_FRAME_HDR_LEN) crc16_update(&s_crc, &c, 1);
+      if (s_headLen == DL_FRAME_HEAD_LEN) head_done();
+      break;
+    case ST_BODY:
+      body_chunk(&c, 1);
+      break;
+    case ST_DCRC:
+      s_dcrc[s_dcrcLen++] = c;
+      if (s_dcrcLen == 2) {
+        bool ok = (crc16_final(&s_crc) == (uint16_t)((s_dcrc[0] << 8) | s_dcrc[1]));
+        reset_frame();
+        if (!ok) s_st.data_crc_err++;
+        else if (s_store) deliver();
+      }
+      break;
+  }
+}
+
+void dl_frame_feed(const uint8_t* data, size_t len) {
+  if (!s_initTried) dl_frame_init();
+  if (len) s_lastByteMs = millis();
+  while (len) {
+    if (s_state == ST_BODY) {
+      size_t k = body_chunk(data, len);
+      data += k;
+      len -= k;
+      continue;
+    }
+    feed_byte(*data++);
+    len--;
+  }
+}
+
+void dl_frame_poll(uint32_t nowMs) {
+  if (s_state == ST_IDLE) return;
+  uint32_t idle = nowMs - s_lastByteMs;
+  if (s_state == ST_HEAD) {
+    if (idle >= DL_HEAD_TIMEOUT_MS) head_fail();
+  } else if (idle >= DL_FRAME_TIMEOUT_MS) {
+    s_st.timeouts++;
+    reset_frame();
+  }
+}
+
+size_t dl_frame_copy(const DlFrame* f, size_t off, uint8_t* dst, size_t n) {
+  size_t got = 0;
+  for (int i = 0; i < 2 && got < n; ++i) {
+    size_t pl = f->partLen[i];
+    if (off >= pl) { off -= pl; continue; }
+    size_t k = pl - off;
+    if (k > n - got) k = n - got;
+    memcpy(dst + got, f->part[i] + off, k);
+    got += k;
+    off = 0;
+  }
+  return got;
+}
+
+void dl_frame_get_stats(DlFrameStats& out) {
+  out = s_st;
+}
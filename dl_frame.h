@@ -0,0 +1,58 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+// 下行帧流式解码：'$' + 21字节头 + 头CRC(2) + payload + 数据CRC(2，payload为空时无)
+// 两个CRC均随字节到达增量计算；头CRC错误时把已收字节交回文本通道并在其后重新找 '$'
+// payload 写入环形缓冲，完整且数据CRC正确后以（至多两段的）视图交给处理函数，不做拷贝
+
+#define DL_FRAME_HDR_LEN   21
+#define DL_FRAME_HEAD_LEN  (DL_FRAME_HDR_LEN + 2)   // 含头CRC
+
+struct DlFrame {
+  const uint8_t* head;      // 23字节（协议头 + 头CRC）
+  char     opType;
+  uint16_t cmd;
+  uint8_t  pid;
+  uint16_t len;             // payload 长度
+  const uint8_t* part[2];   // payload 在环形缓冲中的两段，回绕时 part[1] 非空
+  uint16_t partLen[2];
+};
+
+struct DlFrameStats {
+  uint32_t frames = 0;        // 校验通过并交付的帧
+  uint32_t head_crc_err = 0;  // 头CRC错误（含误把文本中的 '$' 当帧头）
+  uint32_t data_crc_err = 0;  // 数据CRC错误，整帧丢弃
+  uint32_t oversize = 0;      // payload 超过环形缓冲容量：仅校验、计数，不交付
+  uint32_t timeouts = 0;      // 帧接收中途停顿超时（链路中断），已收部分丢弃
+  uint32_t max_len = 0;       // 见过的最大 payload
+  uint32_t ring_size = 0;
+};
+
+typedef void (*DlFrameHandler)(const DlFrame* f);
+typedef void (*DlTextSink)(uint8_t c);
+
+// 分配环形缓冲（PSRAM，容量可容纳 65535 字节 payload；失败时在内部RAM中退到 DL_RING_SIZE_MIN）
+bool dl_frame_init();
+
+// 帧处理函数（解码线程内同步调用，返回后该帧占用的缓冲即被复用）
+void dl_frame_set_handler(DlFrameHandler h);
+// 非帧字节（文本行）的去向
+void dl_frame_set_text_sink(DlTextSink s);
+
+// 送入来自DTU的数据（payload 部分整块拷贝并计算CRC，不逐字节处理）
+void dl_frame_feed(const uint8_t* data, size_t len);
+
+// 超时检查：帧头收不齐（多为文本中的 '$'）时交回文本通道，帧体停顿过久时丢弃
+void dl_frame_poll(uint32_t nowMs);
+
+// 是否处于帧接收中（此时 '>' 等字节属于帧数据）
+bool dl_frame_active();
+
+// 当前帧 payload 还差多少字节（不在帧体内时为0）：这些字节可整块送入
+size_t dl_frame_body_remaining();
+
+// 从帧 payload 的 off 处拷出至多 n 字节（处理函数需要连续小字段时使用），返回实际字节数
+size_t dl_frame_copy(const DlFrame* f, size_t off, uint8_t* dst, size_t n);
+
+void dl_frame_get_stats(DlFrameStats& out);
@@ -0,0 +1,190 @@
+#include "dtu_baud.h"
+#include "dtu_rx.h"
+#include "at_engine.h"
+#include "mipsend.h"
+#include "uart_utils.h"
+#include <Preferences.h>
+
+#define BAUD_NVS_NS   "dtu"
+#define BAUD_NVS_KEY  "baud"
+
+static DtuBaudStats s_st;
+static bool     s_rejected = false;   // 本次运行内不再提速
+static uint8_t  s_failStreak = 0;
+static uint8_t  s_probeLeft = 0;
+static uint32_t s_prevRate = 0;       // 协商前的速率，探测失败时回到该速率
+static bool     s_probeDue = false;   // 已切到高速，等模组稳定后由 dtu_baud_drive 发探测
+static uint32_t s_probeAtMs = 0;
+static bool     s_bootStored = false; // 开机速率取自NVS，尚未握手验证
+static void   (*s_done)(bool ok) = nullptr;
+
+// 线路质量检查基线
+static uint32_t s_checkMs = 0;
+static uint32_t s_frameErr0 = 0;
+static uint32_t s_timeouts0 = 0;
+
+static bool rate_supported(uint32_t b) {
+  return b == DTU_BAUD || (DTU_BAUD_FAST && b == DTU_BAUD_FAST);
+}
+
+static void store_rate(uint32_t b) {
+  Preferences p;
+  if (!p.begin(BAUD_NVS_NS, false)) return;
+  if (b == DTU_BAUD) p.remove(BAUD_NVS_KEY);
+  else if (p.getUInt(BAUD_NVS_KEY, 0) != b) p.putUInt(BAUD_NVS_KEY, b);
+  p.end();
+}
+
+uint32_t dtu_baud_boot_rate() {
+  uint32_t b = DTU_BAUD;
+  Preferences p;
+  if (p.begin(BAUD_NVS_NS, true)) {
+    b = p.getUInt(BAUD_NVS_KEY, DTU_BAUD);
+    p.end();
+  }
+  if (!rate_supported(b)) b = DTU_BAUD;
+  s_bootStored = (b != DTU_BAUD);
+  s_st.current = b;
+  return b;
+}
+
+static void switch_local(uint32_t b) {
+  dtu_rx_set_baud(b);
+  s_st.current = b;
+}
+
+void dtu_baud_on_ping_ok() {
+  s_failStreak = 0;
+  s_bootStored = false;
+}
+
+void dtu_baud_on_ping_fail() {
+  if (s_bootStored) {
+    // NVS中的速率未得到应答（模组可能已复位回默认速率）：立即回到 DTU_BAUD 并清除记录，
+    // 模组若确在高速档，后续换档握手成功后会重新记入
+    s_bootStored = false;
+    s_failStreak = 0;
+    if (dtu_rx_baud() != DTU_BAUD) {
+      log2("[BAUD] stored rate unanswered, back to default");
+      switch_local(DTU_BAUD);
+      store_rate(DTU_BAUD);
+      s_st.hunts++;
+    }
+    return;
+  }
+  if (!DTU_BAUD_FAST) return;
+  if (++s_failStreak < DTU_BAUD_HUNT_FAILS) return;
+  s_failStreak = 0;
+  uint32_t next = (dtu_rx_baud() == DTU_BAUD) ? (uint32_t)DTU_BAUD_FAST : (uint32_t)DTU_BAUD;
+  log2Val("[BAUD] no answer, try ", (int)next);
+  switch_local(next);
+  s_st.hunts++;
+}
+
+static void finish(bool ok) {
+  void (*done)(bool) = s_done;
+  s_done = nullptr;
+  if (done) done(ok);
+}
+
+static void on_probe(AtResult res, const AtLine*, void*) {
+  if (res == AT_RES_OK) {
+    log2Val("[BAUD] switched to ", (int)s_st.current);
+    store_rate(s_st.current);
+    s_st.escalations++;
+    finish(true);
+    return;
+  }
+  if (--s_probeLeft > 0 &&
+      at_submit("AT", nullptr, DTU_BAUD_PROBE_MS, on_probe)) {
+    return;
+  }
+  // 高速下不通：尽力让模组回到原速率（它可能没听到），本端回退
+  log2("[BAUD] probe failed, fall back");
+  char cmd[24];
+  snprintf(cmd, sizeof(cmd), "AT+IPR=%lu", (unsigned long)s_prevRate);
+  sendCmd(cmd);
+  switch_local(s_prevRate);
+  store_rate(s_prevRate);
+  s_rejected = true;
+  s_st.escalate_fail++;
+  finish(false);
+}
+
+static void on_ipr(AtResult res, const AtLine*, void*) {
+  if (res != AT_RES_OK) {
+    // 模组不支持该速率：仍在原速率上
+    log2("[BAUD] IPR rejected");
+    s_rejected = true;
+    s_st.escalate_fail++;
+    finish(false);
+    return;
+  }
+  // OK 以原速率发出，之后模组切换；稳定时间由主循环计时，不在应答回调中等待
+  switch_local(DTU_BAUD_FAST);
+  s_probeLeft = DTU_BAUD_PROBE_TRIES;
+  s_probeAtMs = millis() + DTU_BAUD_SETTLE_MS;
+  s_probeDue = true;
+}
+
+void dtu_baud_drive(uint32_t now) {
+  if (!s_probeDue || (int32_t)(now - s_probeAtMs) < 0) return;
+  s_probeDue = false;
+  if (!at_submit("AT", nullptr, DTU_BAUD_PROBE_MS, on_probe)) {
+    s_probeLeft = 1;
+    on_probe(AT_RES_ERROR, nullptr, nullptr);
+  }
+}
+
+bool dtu_baud_escalate(void (*done)(bool ok)) {
+  if (!DTU_BAUD_FAST || s_rejected || s_done) return false;
+  if (dtu_rx_baud() == DTU_BAUD_FAST) {
+    store_rate(DTU_BAUD_FAST);   // 已在高速档（开机沿用或换档后握手成功）
+    return false;
+  }
+  char cmd[24];
+  snprintf(cmd, sizeof(cmd), "AT+IPR=%lu", (unsigned long)DTU_BAUD_FAST);
+  s_prevRate = dtu_rx_baud();
+  s_done = done;
+  if (!at_submit(cmd, nullptr, AT_TIMEOUT_MS, on_ipr)) {
+    s_done = nullptr;
+    return false;
+  }
+  return true;
+}
+
+static void on_fallback_ipr(AtResult res, const AtLine*, void*) {
+  // 只有模组确认后才切换本端；未确认说明模组仍在高速档，保持现状
+  if (res != AT_RES_OK) return;
+  switch_local(DTU_BAUD);
+  store_rate(DTU_BAUD);
+}
+
+void dtu_baud_check(uint32_t now) {
+  if (now - s_checkMs < DTU_BAUD_CHECK_MS) return;
+  DtuRxStats rx;
+  dtu_rx_get_stats(rx);
+  MipSendStats tx;
+  mipsend_get_total_stats(tx);
+  uint32_t dFrame = rx.frame_err - s_frameErr0;
+  uint32_t dTimeout = tx.timeouts - s_timeouts0;
+  bool first = (s_checkMs == 0);
+  s_checkMs = now;
+  s_frameErr0 = rx.frame_err;
+  s_timeouts0 = tx.timeouts;
+  if (first || rx.baud == DTU_BAUD) return;
+  if (dFrame <= DTU_BAUD_ERR_MAX && dTimeout <= DTU_BAUD_TIMEOUT_MAX) return;
+
+  log2("[BAUD] line errors at high rate, fall back");
+  char cmd[24];
+  snprintf(cmd, sizeof(cmd), "AT+IPR=%lu", (unsigned long)DTU_BAUD);
+  if (at_submit(cmd, nullptr, AT_TIMEOUT_MS, on_fallback_ipr)) {
+    s_rejected = true;
+    s_st.fallbacks++;
+  }
+}
+
+void dtu_baud_get_stats(DtuBaudStats& out) {
+  out = s_st;
+  out.current = dtu_rx_baud();
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+// DTU串口速率协商：115200 是图片上传的主要瓶颈。
+// AT握手成功后发 AT+IPR=<DTU_BAUD_FAST>，本端随即切换，稳定 DTU_BAUD_SETTLE_MS 后探测 AT，成功则把速率记入NVS；
+// 探测失败回到原速率。开机以NVS中的速率启动，该速率首次握手即失败则回到 DTU_BAUD；
+// 之后握手连续失败时在 DTU_BAUD 与高速档之间切换（模组可能仍在另一档）。
+// 高速运行中帧错误或发送应答超时过多则发 AT+IPR 回落到 DTU_BAUD，本次运行内不再提速。
+// 除 dtu_baud_boot_rate 外均须持链路锁调用（comm_manager 中）
+
+struct DtuBaudStats {
+  uint32_t current = 0;        // 当前速率
+  uint32_t escalations = 0;    // 提速成功次数
+  uint32_t escalate_fail = 0;  // 提速被拒或探测失败
+  uint32_t fallbacks = 0;      // 因线路错误回落
+  uint32_t hunts = 0;          // 握手失败后换档
+};
+
+// 开机使用的速率（NVS中已验证的速率，无记录为 DTU_BAUD）
+uint32_t dtu_baud_boot_rate();
+
+// AT握手结果
+void dtu_baud_on_ping_ok();
+void dtu_baud_on_ping_fail();
+
+// 握手成功后调用：需要提速时发起协商并返回 true，结束后（无论成败）回调 done
+bool dtu_baud_escalate(void (*done)(bool ok));
+
+// 提速切换后的定时探测，主循环中每次调用（AT引擎轮询之后）
+void dtu_baud_drive(uint32_t now);
+
+// 高速下的线路质量检查，主循环（监控态）中调用
+void dtu_baud_check(uint32_t now);
+
+void dtu_baud_get_stats(DtuBaudStats& out);
@@ -0,0 +1,183 @@
+#include "dtu_rx.h"
+
+#if !DTU_RX_ASYNC
+// 关闭时直接轮询 Serial
+static uint32_t s_baud = 0;
+void dtu_rx_begin(uint32_t baud) { Serial.begin(baud); s_baud = baud; }
+void dtu_rx_set_baud(uint32_t baud) { Serial.flush(); Serial.updateBaudRate(baud); s_baud = baud; }
+uint32_t dtu_rx_baud() { return s_baud; }
+size_t dtu_rx_available() { return (size_t)Serial.available(); }
+size_t dtu_rx_read(uint8_t* buf, size_t maxLen) {
+  size_t n = (size_t)Serial.available();
+  if (n > maxLen) n = maxLen;
+  return n ? Serial.read(buf, n) : 0;
+}
+int dtu_rx_read_byte() { return Serial.read(); }
+bool dtu_rx_wait(uint32_t timeoutMs) {
+  uint32_t t0 = millis();
+  while (!Serial.available()) {
+    if (millis() - t0 >= timeoutMs) return false;
+    delay(1);
+  }
+  return true;
+}
+void dtu_rx_get_stats(DtuRxStats& out) { out = DtuRxStats(); out.baud = s_baud; }
+
+#else
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <esp_heap_caps.h>
+
+// 单生产者（串口事件任务）/单消费者（readDTU 所在任务）环形缓冲，
+// 读写位置为自由递增计数，差值即占用；容量须为2的幂，计数回绕时取模位置才连续
+static_assert((DTU_RX_RING_SIZE & (DTU_RX_RING_SIZE - 1)) == 0, "DTU_RX_RING_SIZE must be a power of two");
+static_assert((DTU_RX_RING_SIZE_MIN & (DTU_RX_RING_SIZE_MIN - 1)) == 0, "DTU_RX_RING_SIZE_MIN must be a power of two");
+
+static uint8_t* s_ring = nullptr;
+static size_t   s_size = 0;
+static volatile uint32_t s_wr = 0;
+static volatile uint32_t s_rd = 0;
+static SemaphoreHandle_t s_sem = nullptr;
+
+// 统计由串口事件任务更新、主循环读取
+static portMUX_TYPE s_statMux = portMUX_INITIALIZER_UNLOCKED;
+static DtuRxStats s_st;
+
+static void ring_push(const uint8_t* d, size_t n) {
+  uint32_t wr = s_wr;
+  uint32_t used = wr - __atomic_load_n(&s_rd, __ATOMIC_ACQUIRE);
+  size_t room = s_size - used;
+  size_t lost = 0;
+  if (n > room) {
+    lost = n - room;
+    n = room;
+  }
+  size_t off = wr & (s_size - 1);
+  size_t first = s_size - off;
+  if (first > n) first = n;
+  memcpy(s_ring + off, d, first);
+  if (n > first) memcpy(s_ring, d + first, n - first);
+  __atomic_store_n(&s_wr, wr + (uint32_t)n, __ATOMIC_RELEASE);
+  used += (uint32_t)n;
+  portENTER_CRITICAL(&s_statMux);
+  s_st.ring_overflow += (uint32_t)lost;
+  if (used > s_st.high_water) s_st.high_water = used;
+  portEXIT_CRITICAL(&s_statMux);
+}
+
+// 串口驱动事件任务中调用（每个接收超时/FIFO满阈值一次）：把驱动缓冲搬空并唤醒等待方
+static void on_receive() {
+  uint8_t tmp[128];
+  bool got = false;
+  for (;;) {
+    int avail = Serial.available();
+    if (avail <= 0) break;
+    size_t n = (size_t)avail > sizeof(tmp) ? sizeof(tmp) : (size_t)avail;
+    n = Serial.read(tmp, n);
+    if (n == 0) break;
+    portENTER_CRITICAL(&s_statMux);
+    s_st.bytes += (uint32_t)n;
+    portEXIT_CRITICAL(&s_statMux);
+    ring_push(tmp, n);
+    got = true;
+  }
+  if (got && s_sem) xSemaphoreGive(s_sem);
+}
+
+static void on_receive_error(hardwareSerial_error_t err) {
+  portENTER_CRITICAL(&s_statMux);
+  if (err == UART_FIFO_OVF_ERROR) s_st.fifo_ovf++;
+  else if (err == UART_BUFFER_FULL_ERROR) s_st.drv_buf_full++;
+  else if (err == UART_FRAME_ERROR || err == UART_PARITY_ERROR || err == UART_BREAK_ERROR) s_st.frame_err++;
+  portEXIT_CRITICAL(&s_statMux);
+}
+
+void dtu_rx_begin(uint32_t baud) {
+  if (!s_ring) {
+    size_t sz = DTU_RX_RING_SIZE;
+    s_ring = (uint8_t*)heap_caps_malloc(sz, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!s_ring) s_ring = (uint8_t*)heap_caps_malloc(sz, MALLOC_CAP_8BIT);
+    if (!s_ring) {
+      sz = DTU_RX_RING_SIZE_MIN;
+      s_ring = (uint8_t*)heap_caps_malloc(sz, MALLOC_CAP_8BIT);
+    }
+    s_size = s_ring ? sz : 0;
+    portENTER_CRITICAL(&s_statMux);
+    s_st.ring_size = s_size;
+    portEXIT_CRITICAL(&s_statMux);
+  }
+  if (!s_sem) s_sem = xSemaphoreCreateBinary();
+
+  // 接收缓冲须在 begin 之前设置
+  Serial.setRxBufferSize(DTU_RX_DRIVER_BUF);
+  Serial.begin(baud);
+  portENTER_CRITICAL(&s_statMux);
+  s_st.baud = baud;
+  portEXIT_CRITICAL(&s_statMux);
+  if (s_ring && s_sem) {
+    Serial.onReceiveError(on_receive_error);
+    Serial.onReceive(on_receive, false);  // FIFO满阈值与接收超时都回调
+  }
+}
+
+size_t dtu_rx_available() {
+  if (!s_ring) return (size_t)Serial.available();
+  return (size_t)(__atomic_load_n(&s_wr, __ATOMIC_ACQUIRE) - s_rd);
+}
+
+size_t dtu_rx_read(uint8_t* buf, size_t maxLen) {
+  if (!s_ring) {
+    size_t n = (size_t)Serial.available();
+    if (n > maxLen) n = maxLen;
+    return n ? Serial.read(buf, n) : 0;
+  }
+  uint32_t rd = s_rd;
+  size_t n = (size_t)(__atomic_load_n(&s_wr, __ATOMIC_ACQUIRE) - rd);
+  if (n > maxLen) n = maxLen;
+  size_t off = rd & (s_size - 1);
+  size_t first = s_size - off;
+  if (first > n) first = n;
+  memcpy(buf, s_ring + off, first);
+  if (n > first) memcpy(buf + first, s_ring, n - first);
+  __atomic_store_n(&s_rd, rd + (uint32_t)n, __ATOMIC_RELEASE);
+  return n;
+}
+
+void dtu_rx_set_baud(uint32_t baud) {
+  Serial.flush();   // 旧速率下的命令须完整发出
+  Serial.updateBaudRate(baud);
+  portENTER_CRITICAL(&s_statMux);
+  s_st.baud = baud;
+  portEXIT_CRITICAL(&s_statMux);
+}
+
+uint32_t dtu_rx_baud() {
+  portENTER_CRITICAL(&s_statMux);
+  uint32_t b = s_st.baud;
+  portEXIT_CRITICAL(&s_statMux);
+  return b;
+}
+
+int dtu_rx_read_byte() {
+  uint8_t c;
+  return dtu_rx_read(&c, 1) ? (int)c : -1;
+}
+
+bool dtu_rx_wait(uint32_t timeoutMs) {
+  if (dtu_rx_available()) return true;
+  if (!s_ring || !s_sem) {
+    delay(timeoutMs ? 1 : 0);
+    return dtu_rx_available() > 0;
+  }
+  xSemaphoreTake(s_sem, pdMS_TO_TICKS(timeoutMs));
+  return dtu_rx_available() > 0;
+}
+
+void dtu_rx_get_stats(DtuRxStats& out) {
+  portENTER_CRITICAL(&s_statMux);
+  out = s_st;
+  portEXIT_CRITICAL(&s_statMux);
+}
+
+#endif
@@ -0,0 +1,36 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+// DTU串口接收：由串口驱动的事件任务（IDF UART 事件队列）在数据到达时回调，
+// 立即把驱动缓冲搬进大环形缓冲；主循环阻塞（拍照、退避、AT等待）期间不再丢字节
+// 行/帧解析仍在消费方（readDTU）所在任务中完成，回调里不触碰业务状态
+
+struct DtuRxStats {
+  uint32_t bytes = 0;          // 累计接收
+  uint32_t ring_overflow = 0;  // 环形缓冲满被丢弃的字节
+  uint32_t fifo_ovf = 0;       // 硬件FIFO溢出次数（驱动上报）
+  uint32_t drv_buf_full = 0;   // 驱动缓冲满次数（驱动上报）
+  uint32_t frame_err = 0;      // 帧错误/校验错误/BREAK（波特率不匹配或线路干扰）
+  uint32_t high_water = 0;     // 环形缓冲最高占用
+  uint32_t ring_size = 0;
+  uint32_t baud = 0;           // 当前串口波特率
+};
+
+// 打开DTU串口并挂接接收回调（替代 Serial.begin，需在任何AT收发之前调用）
+void dtu_rx_begin(uint32_t baud);
+
+// 运行中切换本端波特率（等待发送缓冲发完）；已收到未读的数据保留在环形缓冲中
+void dtu_rx_set_baud(uint32_t baud);
+uint32_t dtu_rx_baud();
+
+size_t dtu_rx_available();
+// 读出至多 maxLen 字节，返回实际字节数
+size_t dtu_rx_read(uint8_t* buf, size_t maxLen);
+// 读一个字节，无数据返回 -1
+int dtu_rx_read_byte();
+
+// 等待新数据到达，超时返回 false；已有未读数据时立即返回 true
+bool dtu_rx_wait(uint32_t timeoutMs);
+
+void dtu_rx_get_stats(DtuRxStats& out);
@@ -0,0 +1,206 @@
+#include "dtu_tx.h"
+#include "platform_packet.h"
+#include "comm_manager.h"
+#include "link_stats.h"
+#include "ul_ack.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+enum : uint8_t { TX_KIND_PACKET = 0, TX_KIND_JOB };
+
+// 包描述：小包 payload 内联，作业只带回调与上下文
+struct TxDesc {
+  uint8_t  kind;
+  char     opType;
+  uint8_t  pid;
+  uint16_t cmd;
+  uint16_t len;
+  uint32_t enqMs;
+  TxJobFn  job;
+  TxDoneFn done;
+  void*    ctx;
+  uint8_t  payload[DTU_TX_INLINE_MAX];
+};
+
+static const uint8_t TX_DEPTH[TX_PRIO_COUNT] = {
+  DTU_TX_DEPTH_HIGH, DTU_TX_DEPTH_NORMAL, DTU_TX_DEPTH_BULK
+};
+
+static SemaphoreHandle_t s_link = nullptr;                 // 链路锁（递归）
+static QueueHandle_t     s_q[TX_PRIO_COUNT] = {nullptr};
+static SemaphoreHandle_t s_pending = nullptr;              // 各队列描述总数
+static TaskHandle_t      s_task = nullptr;
+static volatile uint32_t s_inflight = 0;                   // 已入队未完成（含正在发送）
+
+// 统计由各生产方任务与发送任务共同更新
+static portMUX_TYPE      s_statMux = portMUX_INITIALIZER_UNLOCKED;
+static DtuTxStats        s_st;
+
+bool dtu_link_lock(uint32_t timeoutMs) {
+  if (!s_link) return true;
+  TickType_t t = (timeoutMs == DTU_LINK_WAIT_FOREVER) ? portMAX_DELAY : pdMS_TO_TICKS(timeoutMs);
+  return xSemaphoreTakeRecursive(s_link, t) == pdTRUE;
+}
+
+void dtu_link_unlock() {
+  if (s_link) xSemaphoreGiveRecursive(s_link);
+}
+
+// 发送一个描述：持链路锁，未连接则直接判失败（由生产方决定是否重试）
+static void run_desc(TxPrio p, TxDesc& d) {
+  DtuTxPrioStats& st = s_st.prio[p];
+  uint32_t wait = millis() - d.enqMs;
+  portENTER_CRITICAL(&s_statMux);
+  if (wait > st.max_wait_ms) st.max_wait_ms = wait;
+  portEXIT_CRITICAL(&s_statMux);
+
+  bool ok = false;
+  uint32_t busy = 0;
+  dtu_link_lock(DTU_LINK_WAIT_FOREVER);
+  if (comm_isConnected()) {
+    uint32_t t0 = millis();
+    if (d.kind == TX_KIND_JOB) {
+      ok = d.job ? d.job(d.ctx) : false;
+    } else {
+      PacketSeg seg = { d.payload, d.len, nullptr, nullptr, false, 0 };
+      ok = sendPlatformPacketSegs(d.opType, d.cmd, d.pid, &seg, 1);
+      if (ok) link_stats_on_request_sent(d.cmd);
+    }
+    busy = millis() - t0;
+    if (ok) link_stats_on_packet_sent();
+  }
+  dtu_link_unlock();
+  // 可靠小包：交给模组后开始等平台确认，失败（含未连接）则待重传
+  if (d.kind == TX_KIND_PACKET) ul_ack_on_sent(d.pid, ok);
+
+  portENTER_CRITICAL(&s_statMux);
+  s_st.busy_ms += busy;
+  if (ok) st.sent++;
+  else st.failed++;
+  portEXIT_CRITICAL(&s_statMux);
+  if (d.done) d.done(ok, d.ctx);
+  __atomic_sub_fetch(&s_inflight, 1, __ATOMIC_RELEASE);
+}
+
+static void tx_task(void*) {
+  for (;;) {
+    xSemaphoreTake(s_pending, portMAX_DELAY);
+    // 高优先级先发；同优先级按入队顺序
+    for (uint8_t p = 0; p < TX_PRIO_COUNT; ++p) {
+      TxDesc d;
+      if (xQueueReceive(s_q[p], &d, 0) == pdTRUE) {
+        run_desc((TxPrio)p, d);
+        break;
+      }
+    }
+  }
+}
+
+static bool submit(TxPrio prio, const TxDesc& d, uint32_t waitMs) {
+  if (prio >= TX_PRIO_COUNT) return false;
+  DtuTxPrioStats& st = s_st.prio[prio];
+  __atomic_add_fetch(&s_inflight, 1, __ATOMIC_ACQ_REL);
+#if DTU_TX_ASYNC
+  if (s_task) {
+    if (xQueueSend(s_q[prio], &d, pdMS_TO_TICKS(waitMs)) != pdTRUE) {
+      __atomic_sub_fetch(&s_inflight, 1, __ATOMIC_RELEASE);
+      portENTER_CRITICAL(&s_statMux);
+      st.drop++;
+      portEXIT_CRITICAL(&s_statMux);
+      return false;
+    }
+    uint32_t depth = uxQueueMessagesWaiting(s_q[prio]);
+    portENTER_CRITICAL(&s_statMux);
+    st.enq++;
+    if (depth > st.high_water) st.high_water = depth;
+    portEXIT_CRITICAL(&s_statMux);
+    xSemaphoreGive(s_pending);
+    return true;
+  }
+#endif
+  // 同步退路：在调用方任务中直接发送
+  (void)waitMs;
+  portENTER_CRITICAL(&s_statMux);
+  st.enq++;
+  portEXIT_CRITICAL(&s_statMux);
+  TxDesc tmp = d;
+  run_desc(prio, tmp);
+  return true;
+}
+
+bool dtu_tx_submit_packet(TxPrio prio, char opType, uint16_t cmd, uint8_t pid,
+                          const uint8_t* payload, uint16_t payloadLen,
+                          uint32_t waitMs) {
+  if (payloadLen > DTU_TX_INLINE_MAX || (payloadLen && !payload)) return false;
+  TxDesc d;
+  d.kind = TX_KIND_PACKET;
+  d.opType = opType;
+  d.pid = pid;
+  d.cmd = cmd;
+  d.len = payloadLen;
+  d.enqMs = millis();
+  d.job = nullptr;
+  d.done = nullptr;
+  d.ctx = nullptr;
+  if (payloadLen) memcpy(d.payload, payload, payloadLen);
+  return submit(prio, d, waitMs);
+}
+
+bool dtu_tx_submit_job(TxPrio prio, TxJobFn job, TxDoneFn done, void* ctx,
+                       uint32_t waitMs) {
+  if (!job) return false;
+  TxDesc d;
+  d.kind = TX_KIND_JOB;
+  d.opType = 0;
+  d.pid = 0;
+  d.cmd = 0;
+  d.len = 0;
+  d.enqMs = millis();
+  d.job = job;
+  d.done = done;
+  d.ctx = ctx;
+  return submit(prio, d, waitMs);
+}
+
+bool dtu_tx_idle() {
+  return __atomic_load_n(&s_inflight, __ATOMIC_ACQUIRE) == 0;
+}
+
+bool dtu_tx_begin() {
+  if (!s_link) s_link = xSemaphoreCreateRecursiveMutex();
+  if (!s_link) return false;
+#if DTU_TX_ASYNC
+  if (s_task) return true;
+  UBaseType_t total = 0;
+  for (uint8_t p = 0; p < TX_PRIO_COUNT; ++p) {
+    if (!s_q[p]) s_q[p] = xQueueCreate(TX_DEPTH[p], sizeof(TxDesc));
+    if (!s_q[p]) return false;
+    total += TX_DEPTH[p];
+  }
+  if (!s_pending) s_pending = xSemaphoreCreateCounting(total, 0);
+  if (!s_pending) return false;
+  BaseType_t rc = xTaskCreatePinnedToCore(tx_task, "dtu_tx",
+                                          DTU_TX_TASK_STACK, nullptr,
+                                          DTU_TX_TASK_PRIO, &s_task,
+                                          tskNO_AFFINITY);
+  if (rc != pdPASS) {
+    s_task = nullptr;
+    return false;
+  }
+#endif
+  return true;
+}
+
+void dtu_tx_get_stats(DtuTxStats& out) {
+  portENTER_CRITICAL(&s_statMux);
+  out = s_st;
+  portEXIT_CRITICAL(&s_statMux);
+  for (uint8_t p = 0; p < TX_PRIO_COUNT; ++p) {
+    out.prio[p].depth = s_q[p] ? uxQueueMessagesWaiting(s_q[p]) : 0;
+  }
+  out.running = s_task != nullptr;
+  out.task_stack_min = s_task ? uxTaskGetStackHighWaterMark(s_task) : 0;
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+// DTU上行发送任务：心跳、实时数据、事件等生产方只把包描述放进队列即返回，
+// 由独立的发送任务按优先级取出，经 mipsend 交给模组；整张图片的十几秒发送不再占用主循环
+//
+// 链路锁：串口收发、AT引擎与连接状态机只能由持锁方操作（递归互斥）。
+// 发送任务整包持锁，期间由它读取应答（readDTU）；主循环在锁被占用时跳过本轮的读取与连接维护，
+// 按钮、拍照、SD 等不受影响
+
+enum TxPrio : uint8_t {
+  TX_PRIO_HIGH = 0,   // 心跳、校时、开机上报
+  TX_PRIO_NORMAL,     // 实时数据、SIM信息
+  TX_PRIO_BULK,       // 事件图片
+  TX_PRIO_COUNT
+};
+
+// 在发送任务中执行（已持链路锁），可连续发送多个包（如图片分片）；返回是否全部成功
+typedef bool (*TxJobFn)(void* ctx);
+// 完成回调：在发送任务中调用，ok=false 含未连接、发送失败
+typedef void (*TxDoneFn)(bool ok, void* ctx);
+
+struct DtuTxPrioStats {
+  uint32_t enq = 0;          // 入队成功
+  uint32_t drop = 0;         // 队列满被拒（背压）
+  uint32_t sent = 0;
+  uint32_t failed = 0;       // 未连接或发送失败
+  uint32_t depth = 0;        // 当前排队数
+  uint32_t high_water = 0;   // 最高排队数
+  uint32_t max_wait_ms = 0;  // 入队到开始发送的最长等待
+};
+
+struct DtuTxStats {
+  DtuTxPrioStats prio[TX_PRIO_COUNT];
+  uint32_t busy_ms = 0;          // 累计发送耗时
+  uint32_t task_stack_min = 0;   // 最小剩余栈
+  bool     running = false;
+};
+
+// 创建链路锁与发送任务（setup 中、dtu_rx_begin 之后调用）；失败时退回同步发送
+bool dtu_tx_begin();
+
+// 小包：payload（≤DTU_TX_INLINE_MAX）随描述拷贝入队，调用方缓冲可立即复用
+// 队列满时等待 waitMs，仍满返回 false（计入 drop）
+bool dtu_tx_submit_packet(TxPrio prio, char opType, uint16_t cmd, uint8_t pid,
+                          const uint8_t* payload, uint16_t payloadLen,
+                          uint32_t waitMs = 0);
+
+// 作业：数据在发送时才由 job 拉取（SD 图片等）；ctx 须保持有效直到 done 回调
+bool dtu_tx_submit_job(TxPrio prio, TxJobFn job, TxDoneFn done, void* ctx,
+                       uint32_t waitMs = 0);
+
+// 队列空且没有正在发送的包
+bool dtu_tx_idle();
+
+void dtu_tx_get_stats(DtuTxStats& out);
+
+// 链路锁（递归）：timeoutMs=0 为尝试加锁；未初始化时总是成功
+#define DTU_LINK_WAIT_FOREVER 0xFFFFFFFFu
+bool dtu_link_lock(uint32_t timeoutMs = 0);
+void dtu_link_unlock();
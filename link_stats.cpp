@@ -0,0 +1,240 @@
+#include "link_stats.h"
+#include "mipsend.h"
+#include <freertos/FreeRTOS.h>
+
+// 各直方图基准：RTT 100ms，建链 1s，吞吐 1000B/s
+static const uint32_t RTT_BASE_MS      = 100;
+static const uint32_t CONNECT_BASE_MS  = 1000;
+static const uint32_t GOODPUT_BASE_BPS = 1000;
+
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+static LinkStatsWindow s_cur;
+static LinkStatsWindow s_last;
+static bool s_inited = false;
+
+// 步骤计时与建链起点
+static uint32_t s_stepEnterMs = 0;
+static uint32_t s_connectStartMs = 0;
+static bool     s_connecting = true;    // 开机即处于建链过程
+
+// 首包计时：开机即开始，断链时重新开始
+static bool     s_ttfpPending = true;
+static bool     s_ttfpBoot = true;
+static uint32_t s_ttfpStartMs = 0;
+static uint32_t s_bootTtfpMs = 0;
+
+// 请求发出时刻（0=无在途请求）
+static uint32_t s_hbSentMs = 0;
+static uint32_t s_tsSentMs = 0;
+
+// 窗口开始时的 mipsend 累计值
+static uint32_t s_lines0 = 0;
+static uint32_t s_bytes0 = 0;
+
+static void hist_reset(LinkHist& h, uint32_t base) {
+  h = LinkHist();
+  h.base = base;
+}
+
+static void window_reset(LinkStatsWindow& w, uint32_t now) {
+  w = LinkStatsWindow();
+  w.start_ms = now;
+  hist_reset(w.rtt_ms, RTT_BASE_MS);
+  hist_reset(w.connect_ms, CONNECT_BASE_MS);
+  hist_reset(w.goodput_bps, GOODPUT_BASE_BPS);
+  hist_reset(w.ttfp_ms, CONNECT_BASE_MS);
+}
+
+static void ensure_init() {
+  if (s_inited) return;
+  s_inited = true;
+  window_reset(s_cur, millis());
+  window_reset(s_last, 0);
+}
+
+static void hist_add(LinkHist& h, uint32_t v) {
+  uint8_t i = 0;
+  uint32_t edge = h.base;
+  while (i < LINK_HIST_BUCKETS - 1 && v >= edge) {
+    ++i;
+    edge <<= 1;
+  }
+  if (h.bucket[i] != 0xFFFF) h.bucket[i]++;
+  if (h.count == 0 || v < h.min) h.min = v;
+  if (v > h.max) h.max = v;
+  h.count++;
+  h.sum += v;
+}
+
+void link_stats_on_step(Step from, Step to) {
+  if (from == to) return;
+  uint32_t now = millis();
+  portENTER_CRITICAL(&s_mux);
+  ensure_init();
+  uint32_t el = now - s_stepEnterMs;
+  s_stepEnterMs = now;
+  s_cur.step_last_ms[from] = el;
+  if (el > s_cur.step_max_ms[from]) s_cur.step_max_ms[from] = el;
+  if (to == STEP_MONITOR) {
+    if (s_connecting) hist_add(s_cur.connect_ms, now - s_connectStartMs);
+    s_connecting = false;
+    s_cur.connects++;
+  } else if (from == STEP_MONITOR) {
+    s_cur.disconnects++;
+    s_connecting = true;
+    s_connectStartMs = now;
+  }
+  portEXIT_CRITICAL(&s_mux);
+}
+
+void link_stats_on_request_sent(uint16_t cmd) {
+  uint32_t now = millis();
+  if (now == 0) now = 1;
+  portENTER_CRITICAL(&s_mux);
+  ensure_init();
+  uint32_t* sent = (cmd == CMD_HEARTBEAT_REQ) ? &s_hbSentMs
+                 : (cmd == CMD_TIME_SYNC_REQ) ? &s_tsSentMs : nullptr;
+  if (sent) {
+    if (*sent) s_cur.rtt_lost++;
+    *sent = now;
+  }
+  portEXIT_CRITICAL(&s_mux);
+}
+
+void link_stats_on_reply(uint16_t cmd) {
+  uint32_t now = millis();
+  portENTER_CRITICAL(&s_mux);
+  ensure_init();
+  uint32_t* sent = (cmd == CMD_HEARTBEAT_REQ) ? &s_hbSentMs
+                 : (cmd == CMD_TIME_SYNC_REQ) ? &s_tsSentMs : nullptr;
+  if (sent && *sent) {
+    hist_add(s_cur.rtt_ms, now - *sent);
+    *sent = 0;
+  }
+  portEXIT_CRITICAL(&s_mux);
+}
+
+void link_stats_on_upload(uint32_t bytes, uint32_t ms) {
+  uint32_t bps = ms ? (uint32_t)((uint64_t)bytes * 1000 / ms) : bytes;
+  portENTER_CRITICAL(&s_mux);
+  ensure_init();
+  hist_add(s_cur.goodput_bps, bps);
+  portEXIT_CRITICAL(&s_mux);
+}
+
+void link_stats_on_link_down() {
+  uint32_t now = millis();
+  portENTER_CRITICAL(&s_mux);
+  if (!s_ttfpPending) {
+    s_ttfpPending = true;
+    s_ttfpStartMs = now;
+  }
+  portEXIT_CRITICAL(&s_mux);
+}
+
+void link_stats_on_packet_sent() {
+  uint32_t now = millis();
+  portENTER_CRITICAL(&s_mux);
+  ensure_init();
+  if (s_ttfpPending) {
+    uint32_t v = now - s_ttfpStartMs;
+    hist_add(s_cur.ttfp_ms, v);
+    if (s_ttfpBoot) s_bootTtfpMs = v ? v : 1;
+    s_ttfpBoot = false;
+    s_ttfpPending = false;
+  }
+  portEXIT_CRITICAL(&s_mux);
+}
+
+uint32_t link_stats_boot_ttfp_ms() {
+  portENTER_CRITICAL(&s_mux);
+  uint32_t v = s_bootTtfpMs;
+  portEXIT_CRITICAL(&s_mux);
+  return v;
+}
+
+bool link_stats_roll(uint32_t now) {
+  MipSendStats tx;
+  mipsend_get_total_stats(tx);
+  portENTER_CRITICAL(&s_mux);
+  ensure_init();
+  bool rolled = false;
+  if (now - s_cur.start_ms >= LINK_STATS_WINDOW_MS) {
+    s_cur.dur_ms = now - s_cur.start_ms;
+    s_cur.lines = tx.lines - s_lines0;
+    s_cur.bytes = tx.bytes_acked - s_bytes0;
+    s_last = s_cur;
+    window_reset(s_cur, now);
+    s_lines0 = tx.lines;
+    s_bytes0 = tx.bytes_acked;
+    rolled = true;
+  }
+  portEXIT_CRITICAL(&s_mux);
+  return rolled;
+}
+
+void link_stats_get(LinkStatsWindow& cur, LinkStatsWindow& last) {
+  MipSendStats tx;
+  mipsend_get_total_stats(tx);
+  portENTER_CRITICAL(&s_mux);
+  ensure_init();
+  cur = s_cur;
+  last = s_last;
+  portEXIT_CRITICAL(&s_mux);
+  cur.dur_ms = millis() - cur.start_ms;
+  cur.lines = tx.lines - s_lines0;
+  cur.bytes = tx.bytes_acked - s_bytes0;
+}
+
+static uint8_t* put16(uint8_t* p, uint32_t v) {
+  if (v > 0xFFFF) v = 0xFFFF;
+  p[0] = (uint8_t)(v >> 8);
+  p[1] = (uint8_t)(v & 0xFF);
+  return p + 2;
+}
+
+static uint8_t* put32(uint8_t* p, uint32_t v) {
+  p[0] = (uint8_t)(v >> 24);
+  p[1] = (uint8_t)(v >> 16);
+  p[2] = (uint8_t)(v >> 8);
+  p[3] = (uint8_t)(v & 0xFF);
+  return p + 4;
+}
+
+static uint8_t* put_hist(uint8_t* p, const LinkHist& h, uint32_t unit) {
+  p = put16(p, h.count);
+  p = put16(p, h.min / unit);
+  p = put16(p, h.max / unit);
+  p = put16(p, h.count ? h.sum / h.count / unit : 0);
+  for (uint8_t i = 0; i < LINK_HIST_BUCKETS; ++i) p = put16(p, h.bucket[i]);
+  return p;
+}
+
+static const size_t LINK_STATS_PAYLOAD_LEN = 7 + 2 + 6 + 8 + 3 * (8 + 2 * LINK_HIST_BUCKETS);
+
+size_t link_stats_encode(uint8_t* out, size_t maxLen, const PlatformTime& t) {
+  if (maxLen < LINK_STATS_PAYLOAD_LEN) return 0;
+  LinkStatsWindow w;
+  portENTER_CRITICAL(&s_mux);
+  ensure_init();
+  w = s_last;
+  portEXIT_CRITICAL(&s_mux);
+
+  uint8_t* p = out;
+  p = put16(p, t.year);
+  *p++ = t.month;
+  *p++ = t.day;
+  *p++ = t.hour;
+  *p++ = t.minute;
+  *p++ = t.second;
+  p = put16(p, w.dur_ms / 1000);
+  p = put16(p, w.connects);
+  p = put16(p, w.disconnects);
+  p = put16(p, w.rtt_lost);
+  p = put32(p, w.lines);
+  p = put32(p, w.bytes);
+  p = put_hist(p, w.rtt_ms, 1);
+  p = put_hist(p, w.connect_ms, 100);
+  p = put_hist(p, w.goodput_bps, 10);
+  return (size_t)(p - out);
+}
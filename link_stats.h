@@ -0,0 +1,58 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+#include "state_machine.h"
+#include "uart_utils.h"
+
+// 链路统计：心跳/校时往返时间、各连接步骤耗时、建链/断链次数、发送行数与字节、每次事件上传的有效吞吐。
+// 按 LINK_STATS_WINDOW_MS 滚动：当前窗口持续累计，窗口结束时转为“上一窗口”供本地读取和上报。
+// 直方图为 8 档倍增分桶：[0,b) [b,2b) [2b,4b) … [64b,∞)，b 为各量的基准值。
+// 各钩子可在不同任务中调用（发送任务、主循环），内部用临界区保护
+
+#define LINK_HIST_BUCKETS 8
+
+struct LinkHist {
+  uint32_t base = 1;
+  uint32_t count = 0;
+  uint32_t sum = 0;
+  uint32_t min = 0;
+  uint32_t max = 0;
+  uint16_t bucket[LINK_HIST_BUCKETS] = {0};
+};
+
+struct LinkStatsWindow {
+  uint32_t start_ms = 0;
+  uint32_t dur_ms = 0;
+  LinkHist rtt_ms;            // 心跳/校时请求发出到平台应答
+  LinkHist connect_ms;        // 从开始建链（开机/断链）到 TCP 建立
+  LinkHist goodput_bps;       // 每次事件上传：图片字节 / 上传耗时
+  uint32_t step_last_ms[STEP_MONITOR + 1] = {0};   // 各步最近一次停留时间
+  uint32_t step_max_ms[STEP_MONITOR + 1] = {0};
+  uint16_t connects = 0;
+  uint16_t disconnects = 0;
+  uint16_t rtt_lost = 0;      // 未等到应答就发出下一次请求
+  LinkHist ttfp_ms;           // 开机/断链到第一个上行包交给模组（含退避等待，不上报）
+  uint32_t lines = 0;         // MIPSEND 次数（含重传）
+  uint32_t bytes = 0;         // 模组确认的字节
+};
+
+// 钩子
+void link_stats_on_step(Step from, Step to);              // comm_gotoStep 中调用
+void link_stats_on_request_sent(uint16_t cmd);            // 心跳/校时请求发出（发送任务）
+void link_stats_on_reply(uint16_t cmd);                   // 对应下行应答到达
+void link_stats_on_upload(uint32_t bytes, uint32_t ms);   // 一次事件上传完成
+void link_stats_on_link_down();                           // 已建立的连接断开（首包计时起点）
+void link_stats_on_packet_sent();                         // 任一上行包交给模组（发送任务）
+
+// 开机到第一个上行包的时间，0=尚未发出
+uint32_t link_stats_boot_ttfp_ms();
+
+// 窗口到期则滚动，返回 true 表示刚结束一个窗口（可上报）
+bool link_stats_roll(uint32_t now);
+
+void link_stats_get(LinkStatsWindow& cur, LinkStatsWindow& last);
+
+// 上一窗口编码为上报 payload（95 字节，大端），返回长度
+// 时间7 | 窗口秒数2 | 建链2 断链2 RTT丢失2 | 行数4 字节4 |
+// 3×直方图(RTT ms、建链 100ms、吞吐 10B/s)：count2 min2 max2 avg2 bucket 8×2（超过 0xFFFF 截断）
+size_t link_stats_encode(uint8_t* out, size_t maxLen, const PlatformTime& t);
@@ -9,6 +9,11 @@
 #include "camera_module.h"
 #include "sdcard_module.h"
 #include "sd_async.h"
+#include "upload_manager.h"
+#include "sd_journal.h"
+#include "dtu_rx.h"
+#include "dtu_tx.h"
+#include "dtu_baud.h"
 #include "flash_module.h"
 #include <Preferences.h>
 #include "esp_system.h"
@@ -62,17 +67,17 @@ static void init_task(void* arg);
 // 打印复位原因并统计 boot count（NVS）
 static void log_and_count_boot() {
   esp_reset_reason_t r = esp_reset_reason();
-  Serial.print("Reset reason: "); Serial.println((int)r);
+  log2Val("Reset reason: ", (int)r);
 
   // 使用 preferences 计数连续失败的次数
   if (!prefs.begin("boot", false)) {
-    Serial.println("[BOOT] NVS open failed");
+    log2("[BOOT] NVS open failed");
     return;
   }
   uint32_t bc = prefs.getUInt("bootcnt", 0);
   bc++;
   prefs.putUInt("bootcnt", bc);
-  Serial.print("[BOOT] boot_count="); Serial.println(bc);
+  log2Val("[BOOT] boot_count=", (int)bc);
   prefs.end();
 }
 
@@ -136,8 +141,7 @@ static void pre_reset_peripherals_once() {
 // 在 init_task 中按阶段初始化，带超时与 WDT 保护
 static void run_staged_init(bool safe_mode) {
   // 如果进入安全模式，跳过 camera/SD 的启动
-  Serial.print("[INIT] safe_mode=");
-  Serial.println(safe_mode ? "YES" : "NO");
+  log2Str("[INIT] safe_mode=", safe_mode ? "YES" : "NO");
 
   bool camera_initialized = false;
   bool sd_initialized = false;
@@ -145,26 +149,26 @@ static void run_staged_init(bool safe_mode) {
   if (!safe_mode) {
     // Camera init with stage timeout
     uint32_t t0 = millis();
-    Serial.println("[INIT] Starting camera init...");
+    log2("[INIT] Starting camera init...");
     // try init in a blocking call but we guard whole task by WDT and per-stage timeout
     camera_initialized = init_camera_multi();
     if (camera_initialized) {
-      Serial.println("[INIT] Camera OK");
+      log2("[INIT] Camera OK");
     } else {
-      Serial.println("[INIT] Camera FAILED");
+      log2("[INIT] Camera FAILED");
     }
     // if camera init exceeded stage time, it's okay: we check result and may recover later
     if (millis() - t0 > INIT_STAGE_TIMEOUT_MS) {
-      Serial.println("[INIT] Camera init exceeded stage timeout");
+      log2("[INIT] Camera init exceeded stage timeout");
     }
     vTaskDelay(pdMS_TO_TICKS(STAGE_INIT_DELAY_MS));
   } else {
-    Serial.println("[INIT] Skipping camera in safe mode");
+    log2("[INIT] Skipping camera in safe mode");
   }
 
   // SD init (non-blocking guarded)
   if (!safe_mode) {
-    Serial.println("[INIT] Starting SD init...");
+    log2("[INIT] Starting SD init...");
     uint32_t t0 = millis();
     init_sd(); // existing function; may be quick or blocking in some drivers
     // Wait briefly for card presence check, but don't block too long
@@ -172,11 +176,11 @@ static void run_staged_init(bool safe_mode) {
       if (SD.cardType() != CARD_NONE) { sd_initialized = true; break;}
       vTaskDelay(pdMS_TO_TICKS(100));
     }
-    if (sd_initialized) Serial.println("[INIT] SD OK");
-    else Serial.println("[INIT] SD not ready");
+    if (sd_initialized) log2("[INIT] SD OK");
+    else log2("[INIT] SD not ready");
     vTaskDelay(pdMS_TO_TICKS(STAGE_INIT_DELAY_MS));
   } else {
-    Serial.println("[INIT] Skipping SD in safe mode");
+    log2("[INIT] Skipping SD in safe mode");
   }
 
   // Start async SD task only if sd ok and not safe mode
@@ -184,9 +188,9 @@ static void run_staged_init(bool safe_mode) {
     if (sd_async_init()) {
       sd_async_start();
       sd_async_on_sd_ready();
-      Serial.println("[INIT] SD async started");
+      log2("[INIT] SD async started");
     } else {
-      Serial.println("[INIT] SD async init failed");
+      log2("[INIT] SD async init failed");
     }
   }
 
@@ -194,7 +198,7 @@ static void run_staged_init(bool safe_mode) {
   flashInit();
 
   if (!prefs.begin("cfg", false)) {
-    Serial.println("[INIT] NVS prefs open failed");
+    log2("[INIT] NVS prefs open failed");
   } else {
     load_params_from_nvs();
     prefs.end();
@@ -202,18 +206,24 @@ static void run_staged_init(bool safe_mode) {
 
   rtc_init();
 
+  // 恢复断电/重启前未完成的事件图片传输，打开离线日志
+  if (!safe_mode && sd_initialized) {
+    upload_restore_pending();
+    sd_journal_begin();
+  }
+
   // initial test photo only if not in safe mode and both camera+sd present
   if (!safe_mode && camera_initialized && sd_initialized) {
-    Serial.println("[INIT] Taking initial test photo (save only)...");
+    log2("[INIT] Taking initial test photo (save only)...");
     bool prevSend = g_cfg.sendEnabled;
     bool prevAsync = g_cfg.asyncSDWrite;
     g_cfg.sendEnabled = false;
     (void)capture_and_process(TRIGGER_BUTTON, false);
     g_cfg.sendEnabled = prevSend;
     g_cfg.asyncSDWrite = prevAsync;
-    Serial.println("[INIT] Initial test photo done");
+    log2("[INIT] Initial test photo done");
   } else {
-    Serial.println("[INIT] Skipping test photo");
+    log2("[INIT] Skipping test photo");
   }
 
   // mark success: clear boot count
@@ -230,7 +240,7 @@ static void init_task(void* arg) {
   uint32_t bc = read_boot_count();
   if (bc >= SAFE_BOOT_THRESHOLD) {
     g_safe_mode = true;
-    Serial.println("[INIT_TASK] Entering SAFE MODE due to repeated boot failures");
+    log2("[INIT_TASK] Entering SAFE MODE due to repeated boot failures");
   } else {
     g_safe_mode = false;
   }
@@ -239,8 +249,7 @@ static void init_task(void* arg) {
   int attempt = 0;
   while (attempt <= MAX_INIT_RECOVERY_TRIES && !g_init_complete) {
     attempt++;
-    Serial.print("[INIT_TASK] Attempt ");
-    Serial.println(attempt);
+    log2Val("[INIT_TASK] Attempt ", attempt);
     // feed watchdog periodically while doing init
     esp_task_wdt_reset();
 
@@ -250,7 +259,7 @@ static void init_task(void* arg) {
     if (g_init_complete) break;
 
     // otherwise try some recovery actions (best-effort)
-    Serial.println("[INIT_TASK] Init not complete, trying recovery actions...");
+    log2("[INIT_TASK] Init not complete, trying recovery actions...");
     // soft-power-cycle modem (AT commands best-effort)
     modem_soft_power_cycle();
     // toggle camera PWDN if available
@@ -261,9 +270,7 @@ static void init_task(void* arg) {
     // backoff
     uint32_t backoff = 500 * (1UL << min(attempt, 6));
     if (backoff > 15000) backoff = 15000;
-    Serial.print("[INIT_TASK] Backing off ");
-    Serial.print(backoff);
-    Serial.println(" ms");
+    log2Val("[INIT_TASK] Backing off ms=", (int)backoff);
     uint32_t st = millis();
     while (millis() - st < backoff) {
       esp_task_wdt_reset();
@@ -272,7 +279,7 @@ static void init_task(void* arg) {
   }
 
   if (!g_init_complete) {
-    Serial.println("[INIT_TASK] Initialization FAILED after attempts. Triggering restart.");
+    log2("[INIT_TASK] Initialization FAILED after attempts. Triggering restart.");
     // leave boot count increment as-is so next boot likely goes safe mode
     vTaskDelay(pdMS_TO_TICKS(200));
     esp_task_wdt_reset();
@@ -281,7 +288,7 @@ static void init_task(void* arg) {
     ESP.restart();
     // not reached
   } else {
-    Serial.println("[INIT_TASK] Initialization COMPLETE.");
+    log2("[INIT_TASK] Initialization COMPLETE.");
     // remove task wdt membership for this task since it's done
     esp_task_wdt_delete(NULL);
   }
@@ -291,19 +298,22 @@ static void init_task(void* arg) {
 }
 
 void setup() {
-  Serial.begin(DTU_BAUD);
+  // 调试输出一律走 Serial2（log2）：Serial 是 DTU 链路，只有持链路锁的一方可以写
 #if ENABLE_LOG2
   Serial2.begin(LOG_BAUD, SERIAL_8N1, RX2, TX2);
 #endif
+  dtu_rx_begin(dtu_baud_boot_rate());   // DTU串口（沿用上次协商的速率）：接收由驱动事件回调搬运到环形缓冲
+  if (!dtu_tx_begin()) {     // DTU上行发送任务：业务包入队即返回
+    log2("[BOOT] DTU TX task failed, send synchronously");
+  }
 
-  Serial.println("==== System Boot ====");
+  log2("==== System Boot ====");
   // count boot and decide safe mode later in init_task
   if (!prefs.begin("boot", false)) {
-    Serial.println("[BOOT] prefs begin failed");
+    log2("[BOOT] prefs begin failed");
   } else {
     uint32_t bc = prefs.getUInt("bootcnt", 0);
-    Serial.print("[BOOT] previous boot_count=");
-    Serial.println(bc);
+    log2Val("[BOOT] previous boot_count=", (int)bc);
     prefs.end();
   }
 
@@ -317,7 +327,7 @@ void setup() {
                                           8192, nullptr,
                                           2, nullptr, tskNO_AFFINITY);
   if (rc != pdPASS) {
-    Serial.println("[BOOT] Failed to create init_task - performing direct init fallback");
+    log2("[BOOT] Failed to create init_task - performing direct init fallback");
     // fallback: do direct init in-line but with conservative delays
     run_staged_init(false);
     g_init_complete = true;
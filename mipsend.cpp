@@ -0,0 +1,367 @@
+#include "mipsend.h"
+#include "at_engine.h"
+#include "config.h"
+#include "uart_utils.h"
+#include <freertos/FreeRTOS.h>
+
+// "AT+MIPSEND=0,0," 长度
+static const size_t MIPSEND_PREFIX_LEN = 15;
+
+// 每块单次最多重传次数，超过则放弃本包
+static const uint8_t MIPSEND_MAX_TRIES = 3;
+// 连续成功多少块后加深窗口、增大块长
+static const uint16_t MIPSEND_GROW_STREAK = 16;
+
+static MipSendMode s_mode = MIPSEND_MODE_HEX;
+static bool s_busy = false;
+static bool s_aborted = false;
+static bool s_linkError = false;
+static bool s_streamError = false; // 流上有空洞，连接重建前不再发包
+
+// 发送窗口：每块占一个槽，按发送顺序等待模组最终应答（OK/ERROR）
+// 槽同时充当暂存区：写入数据先填入下一个空槽，填满即发出
+typedef enum { SLOT_FILL = 0, SLOT_SENT, SLOT_OK, SLOT_ERR } SlotState;
+struct Slot {
+    uint16_t len;
+    uint8_t  state;
+    uint8_t  tries;
+    uint8_t  data[MIPSEND_RAW_CHUNK];
+};
+static Slot    s_slots[MIPSEND_WINDOW_MAX];
+static uint8_t s_head = 0;        // 最早未确认的槽
+static uint8_t s_count = 0;       // 已发出未释放的槽数
+static uint8_t s_window = 1;      // 当前窗口深度（自适应，1..window_max()）
+static size_t  s_chunk = 0;       // 当前块长（自适应，0 表示按模式取上限）
+static uint16_t s_okStreak = 0;
+
+// s_pkt 为当前包（发送任务内使用），包结束时累加到本次上传与开机累计
+static portMUX_TYPE s_statMux = portMUX_INITIALIZER_UNLOCKED;
+static MipSendStats s_pkt;
+static MipSendStats s_upload;
+static MipSendStats s_last;
+static MipSendStats s_total;
+static bool     s_inUpload = false;
+static uint32_t s_uploadStartMs = 0;
+static uint32_t s_pktStartMs = 0;
+
+// 字节 → 两个HEX字符的查找表（16位一项，内存序即输出序）
+static uint16_t s_hexLut[256];
+static volatile bool s_lutReady = false;
+
+// 整行缓冲：前缀从 [1] 开始写，使 HEX 区起于偶地址 [16]，
+// 可按 uint16_t 直接存表项（Xtensa 不支持非对齐半字访问）
+static uint8_t s_line[1 + MIPSEND_PREFIX_LEN + 2 * MIPSEND_BIN_CHUNK + 2] __attribute__((aligned(4)));
+
+static void hex_lut_build() {
+    static const char* HEXCHARS = "0123456789ABCDEF";
+    for (int b = 0; b < 256; ++b) {
+        uint8_t pair[2] = { (uint8_t)HEXCHARS[b >> 4], (uint8_t)HEXCHARS[b & 0x0F] };
+        memcpy(&s_hexLut[b], pair, 2);
+    }
+    memcpy(s_line + 1, "AT+MIPSEND=0,0,", MIPSEND_PREFIX_LEN);
+    s_lutReady = true;
+}
+
+// 组装一整行到 s_line 并一次写出（n ≤ MIPSEND_BIN_CHUNK）
+static void send_hex_line(const uint8_t* data, size_t n) {
+    if (!s_lutReady) hex_lut_build();
+    uint16_t* out = (uint16_t*)(s_line + 1 + MIPSEND_PREFIX_LEN);
+    for (size_t i = 0; i < n; ++i) out[i] = s_hexLut[data[i]];
+    uint8_t* tail = (uint8_t*)(out + n);
+    tail[0] = '\r';
+    tail[1] = '\n';
+    Serial.write(s_line + 1, MIPSEND_PREFIX_LEN + 2 * n + 2);
+}
+
+// 提示符模式发送一块原始字节
+static bool send_binary(const uint8_t* data, size_t len) {
+    char cmd[32];
+    snprintf(cmd, sizeof(cmd), "AT+MIPSEND=0,%u", (unsigned)len);
+    sendCmd(cmd);
+    if (!dtu_wait_prompt('>', MIPSEND_PROMPT_TIMEOUT_MS)) {
+        log2("[MIPSEND] prompt timeout");
+        s_linkError = true;
+        return false;
+    }
+    Serial.write(data, len);
+    return true;
+}
+
+static size_t chunk_max() {
+    return s_mode == MIPSEND_MODE_BINARY ? MIPSEND_RAW_CHUNK : MIPSEND_BIN_CHUNK;
+}
+
+// 提示符模式只能停等：下一块的命令若在上一块应答前发出，'>' 与上一块的 OK/ERROR 会交错，
+// 应答可能记到错误的槽上
+static uint8_t window_max() {
+    return s_mode == MIPSEND_MODE_BINARY ? 1 : MIPSEND_WINDOW_MAX;
+}
+
+static size_t chunk_size() {
+    size_t mx = chunk_max();
+    if (s_chunk == 0 || s_chunk > mx) s_chunk = mx;
+    return s_chunk;
+}
+
+static inline Slot& slot_at(uint8_t i) {
+    return s_slots[(s_head + i) % MIPSEND_WINDOW_MAX];
+}
+
+static void transmit(Slot& sl) {
+    if (s_mode == MIPSEND_MODE_BINARY) {
+        if (!send_binary(sl.data, sl.len)) { s_aborted = true; return; }
+    } else {
+        send_hex_line(sl.data, sl.len);
+    }
+    sl.state = SLOT_SENT;
+    sl.tries++;
+    s_pkt.lines++;
+}
+
+// 应答后调整：成功累积则加深窗口/增大块长，出错则退回停等并减半块长
+static void on_block_ok(const Slot& sl) {
+    s_pkt.bytes_acked += sl.len;
+    if (++s_okStreak >= MIPSEND_GROW_STREAK) {
+        s_okStreak = 0;
+        if (s_window < window_max()) s_window++;
+        size_t mx = chunk_max();
+        size_t c = chunk_size() + mx / 4;
+        s_chunk = c > mx ? mx : c;
+    }
+}
+
+static void on_block_err() {
+    s_pkt.errors++;
+    s_okStreak = 0;
+    s_window = 1;
+    size_t c = chunk_size() / 2;
+    s_chunk = c < MIPSEND_CHUNK_MIN ? MIPSEND_CHUNK_MIN : c;
+}
+
+// 本包已有部分字节进入TCP流却无法送完：平台分帧会失步，放弃本包并由连接管理关闭重连
+static void stream_broken(const char* why) {
+    log2(why);
+    s_pkt.stream_errors++;
+    s_streamError = true;
+    s_aborted = true;
+}
+
+// 处理窗口头部已有结果的槽：OK 释放；ERROR 在其后的块都有结果后决定重传或判定失序
+static void settle_head() {
+    while (s_count && !s_aborted) {
+        Slot& h = slot_at(0);
+        if (h.state == SLOT_OK) {
+            on_block_ok(h);
+            s_head = (s_head + 1) % MIPSEND_WINDOW_MAX;
+            s_count--;
+            continue;
+        }
+        if (h.state != SLOT_ERR) return;
+
+        bool laterOk = false;
+        for (uint8_t i = 1; i < s_count; ++i) {
+            uint8_t st = slot_at(i).state;
+            if (st == SLOT_SENT) return;      // 等后续块结果
+            if (st == SLOT_OK) laterOk = true;
+        }
+        if (laterOk) {
+            // 后续块已被接受：TCP流上出现空洞，无法按序补发
+            stream_broken("[MIPSEND] stream hole, reconnect");
+            return;
+        }
+        if (h.tries >= MIPSEND_MAX_TRIES) {
+            if (s_pkt.bytes_acked) stream_broken("[MIPSEND] packet truncated, reconnect");
+            else s_aborted = true;
+            return;
+        }
+        // 头部及其后全部被拒：按原顺序整体重传（go-back-N）
+        for (uint8_t i = 0; i < s_count && !s_aborted; ++i) {
+            s_pkt.retransmits++;
+            transmit(slot_at(i));
+        }
+        return;
+    }
+}
+
+// 收取应答直到已发出未释放的块数 ≤ maxOutstanding；超时则放弃本包
+static void wait_outstanding(uint8_t maxOutstanding) {
+    uint32_t t0 = millis();
+    uint8_t lastCount = s_count;
+    while (!s_aborted) {
+        settle_head();
+        if (s_count <= maxOutstanding || s_aborted) return;
+        readDTU();
+        if (s_count != lastCount) { lastCount = s_count; t0 = millis(); }
+        if (millis() - t0 > MIPSEND_ACK_TIMEOUT_MS) {
+            // 未应答的块是否已进入流无从得知
+            s_pkt.timeouts++;
+            s_window = 1;
+            stream_broken("[MIPSEND] ack timeout, reconnect");
+            return;
+        }
+        delay(1);
+    }
+}
+
+// 发出当前填充槽（窗口已满时先等待应答）
+static void commit_fill() {
+    Slot& f = slot_at(s_count);
+    if (f.len == 0) return;
+    s_count++;
+    transmit(f);
+    wait_outstanding(s_window - 1);
+}
+
+// 累加一个包的计数；窗口/块长取最新值
+static void stats_add(MipSendStats& dst, const MipSendStats& p) {
+    dst.lines         += p.lines;
+    dst.bytes_acked   += p.bytes_acked;
+    dst.retransmits   += p.retransmits;
+    dst.errors        += p.errors;
+    dst.timeouts      += p.timeouts;
+    dst.stream_errors += p.stream_errors;
+    dst.elapsed_ms    += p.elapsed_ms;
+    dst.window = p.window;
+    dst.chunk  = p.chunk;
+}
+
+void mipsend_set_mode(MipSendMode mode) {
+    if (s_busy) return;
+    s_mode = mode;
+    s_chunk = 0;
+    s_window = 1;
+}
+
+MipSendMode mipsend_get_mode() { return s_mode; }
+
+void mipsend_begin() {
+    // 在途AT命令的 OK/ERROR 不能被当作 MIPSEND 应答：先等它完成
+    at_engine_wait_idle();
+    s_busy = true;
+    s_aborted = s_streamError;   // 旧连接上流已失步：等连接管理重建
+    s_head = 0;
+    s_count = 0;
+    memset(&s_pkt, 0, sizeof(s_pkt));
+    s_pktStartMs = millis();
+    Slot& f = slot_at(0);
+    f.len = 0; f.tries = 0; f.state = SLOT_FILL;
+}
+
+void mipsend_write(const uint8_t* data, size_t len) {
+    while (len && !s_aborted) {
+        Slot& f = slot_at(s_count);
+        size_t cs = chunk_size();
+        if (f.len < cs) {
+            size_t k = cs - f.len;
+            if (k > len) k = len;
+            memcpy(f.data + f.len, data, k);
+            f.len += k;
+            data += k;
+            len  -= k;
+        }
+        if (f.len >= cs) {
+            commit_fill();
+            if (s_aborted) break;
+            Slot& n = slot_at(s_count);
+            n.len = 0; n.tries = 0; n.state = SLOT_FILL;
+        }
+    }
+}
+
+bool mipsend_end() {
+    if (!s_aborted) commit_fill();
+    wait_outstanding(0);
+
+    s_pkt.elapsed_ms = millis() - s_pktStartMs;
+    s_pkt.window = s_window;
+    s_pkt.chunk = (uint16_t)chunk_size();
+    portENTER_CRITICAL(&s_statMux);
+    stats_add(s_total, s_pkt);
+    s_total.goodput_bps = s_total.elapsed_ms ? (uint32_t)((uint64_t)s_total.bytes_acked * 1000 / s_total.elapsed_ms) : 0;
+    if (s_inUpload) stats_add(s_upload, s_pkt);
+    portEXIT_CRITICAL(&s_statMux);
+
+    bool ok = !s_aborted;
+    s_busy = false;
+    s_aborted = false;
+    s_count = 0;
+    return ok;
+}
+
+bool mipsend_busy() { return s_busy; }
+
+void mipsend_abort() {
+    if (s_busy) s_aborted = true;
+}
+
+// 按发送顺序把最终应答记到最早一个等待中的块上
+static bool mark_first_sent(uint8_t state) {
+    for (uint8_t i = 0; i < s_count; ++i) {
+        Slot& sl = slot_at(i);
+        if (sl.state == SLOT_SENT) {
+            sl.state = state;
+            if (state == SLOT_ERR) on_block_err();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool mipsend_on_line(const AtLine& line) {
+    if (line.kind == AT_LINE_MIPSEND) return true;
+    if (!s_busy) return false;
+    // 发送过程中的 OK/ERROR 均为 MIPSEND 的最终应答，不交给连接状态机
+    if (line.kind == AT_LINE_OK) {
+        mark_first_sent(SLOT_OK);
+        return true;
+    }
+    if (line.kind == AT_LINE_ERROR) {
+        mark_first_sent(SLOT_ERR);
+        return true;
+    }
+    return false;
+}
+
+bool mipsend_take_link_error() {
+    bool e = s_linkError;
+    s_linkError = false;
+    return e;
+}
+
+bool mipsend_take_stream_error() {
+    bool e = s_streamError;
+    s_streamError = false;
+    return e;
+}
+
+void mipsend_upload_begin() {
+    portENTER_CRITICAL(&s_statMux);
+    memset(&s_upload, 0, sizeof(s_upload));
+    s_uploadStartMs = millis();
+    s_inUpload = true;
+    portEXIT_CRITICAL(&s_statMux);
+}
+
+// 上传的吞吐按整次上传的墙钟时间计（含包间等待），elapsed_ms 仍为各包发送耗时之和
+void mipsend_upload_end() {
+    uint32_t dur = millis() - s_uploadStartMs;
+    portENTER_CRITICAL(&s_statMux);
+    if (s_inUpload) {
+        s_inUpload = false;
+        s_upload.goodput_bps = dur ? (uint32_t)((uint64_t)s_upload.bytes_acked * 1000 / dur) : 0;
+        s_last = s_upload;
+    }
+    portEXIT_CRITICAL(&s_statMux);
+}
+
+void mipsend_get_last_stats(MipSendStats& out) {
+    portENTER_CRITICAL(&s_statMux);
+    out = s_last;
+    portEXIT_CRITICAL(&s_statMux);
+}
+
+void mipsend_get_total_stats(MipSendStats& out) {
+    portENTER_CRITICAL(&s_statMux);
+    out = s_total;
+    portEXIT_CRITICAL(&s_statMux);
+}
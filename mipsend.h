@@ -0,0 +1,64 @@
+#pragma once
+#include <Arduino.h>
+#include "at_parser.h"
+
+// DTU 上行链路：把一个平台包的字节流交给模组发送
+// HEX 模式：每块封装成 AT+MIPSEND=0,0,<HEX>\r\n 一行
+// 二进制模式：AT+MIPSEND=0,<len> → 等待 '>' 提示符 → 原样写入 len 字节
+// 多个包依次在 TCP 上连续发送，平台协议数据在流上保持连续
+//
+// 流控：按模组对每块的最终应答（OK/ERROR）推进发送窗口，不再盲等；
+// 窗口深度与块长按应答自适应（成功累积加深/加长，出错退回停等并减半）；提示符（二进制）模式固定停等
+// 某块被拒而其后的块已被接受时，TCP 流上出现空洞、平台按 '$' 分帧会失步：
+// 放弃本包并报流错误，由连接管理关闭并重建连接，重建前的包一律判失败
+
+// HEX 模式每条 MIPSEND 行承载的二进制字节数上限（将被转成 2x HEX 字符）
+static const size_t MIPSEND_BIN_CHUNK = 128;
+
+typedef enum {
+    MIPSEND_MODE_HEX = 0,
+    MIPSEND_MODE_BINARY
+} MipSendMode;
+
+// 发送模式由连接流程协商（AT+MIPCFG="encoding"），包发送过程中不可切换
+void mipsend_set_mode(MipSendMode mode);
+MipSendMode mipsend_get_mode();
+
+// 一个平台包的发送：begin → write(多次) → end
+// 写入的数据先在内部暂存，攒满一块再发，小段（头、元数据、CRC）不单独占一行
+void mipsend_begin();
+void mipsend_write(const uint8_t* data, size_t len);
+bool mipsend_end();          // 发出剩余数据；返回整包是否全部交给了模组
+
+bool mipsend_busy();         // 是否处于包发送过程中
+void mipsend_abort();        // 链路已断：丢弃本包剩余数据
+
+// 行钩子：发送过程中模组的应答（OK/ERROR/+MIPSEND）由此消费，返回 true 表示已处理
+bool mipsend_on_line(const AtLine& line);
+
+// 二进制模式下提示符超时等链路级错误（读后清除），由连接管理回退到HEX并重连
+bool mipsend_take_link_error();
+
+// 流上出现空洞（读后清除），由连接管理 MIPCLOSE 后重连
+bool mipsend_take_stream_error();
+
+// 发送统计：last 为最近一次上传（begin/end 之间发出的所有包），total 为开机累计
+typedef struct {
+    uint32_t lines;          // 发出的 MIPSEND 次数（含重传）
+    uint32_t bytes_acked;    // 模组确认接受的字节数
+    uint32_t retransmits;    // 重传块数
+    uint32_t errors;         // 模组返回 ERROR 次数
+    uint32_t timeouts;       // 等待应答超时次数
+    uint32_t stream_errors;  // 因乱序无法补发而判失败的块数
+    uint32_t elapsed_ms;     // 发送耗时
+    uint32_t goodput_bps;    // 有效吞吐（字节/秒）
+    uint8_t  window;         // 结束时的窗口深度
+    uint16_t chunk;          // 结束时的块长
+} MipSendStats;
+
+// 一次上传的统计区间（主循环调用）；区间内的包累加到同一份统计，end 时转为 last
+void mipsend_upload_begin();
+void mipsend_upload_end();
+
+void mipsend_get_last_stats(MipSendStats& out);
+void mipsend_get_total_stats(MipSendStats& out);
@@ -0,0 +1,166 @@
+#include "packet_trace.h"
+
+#if PKT_TRACE_ENABLE
+
+#include <FS.h>
+#include <SD.h>
+#include <freertos/FreeRTOS.h>
+
+static PktTraceSink s_sink = (PktTraceSink)PKT_TRACE_DEFAULT_SINK;
+static PktTraceMode s_mode = (PktTraceMode)PKT_TRACE_DEFAULT_MODE;
+static uint16_t s_sampleEvery = PKT_TRACE_SAMPLE_EVERY;
+static uint32_t s_pktCounter = 0;
+static bool     s_active = false;     // 当前包是否在记录（至少记录头）
+static size_t   s_dataCol = 0;        // 当前HEX行已输出字节数
+bool g_ptraceData = false;
+
+static PktTraceStats s_stats;
+
+// RAM 环形缓冲（文本）
+static char     s_ring[PKT_TRACE_RING_SIZE];
+static size_t   s_ringHead = 0;       // 写位置
+static size_t   s_ringLen = 0;        // 有效字节数
+static portMUX_TYPE s_ringMux = portMUX_INITIALIZER_UNLOCKED;
+
+// SD sink 行缓冲：攒满或包结束时追加写入，减少SD打开次数
+static char     s_sdBuf[512];
+static size_t   s_sdLen = 0;
+
+static void ring_write(const char* s, size_t n) {
+    portENTER_CRITICAL(&s_ringMux);
+    for (size_t i = 0; i < n; ++i) {
+        s_ring[s_ringHead] = s[i];
+        s_ringHead = (s_ringHead + 1) % PKT_TRACE_RING_SIZE;
+        if (s_ringLen < PKT_TRACE_RING_SIZE) s_ringLen++;
+        else s_stats.ring_dropped++;
+    }
+    portEXIT_CRITICAL(&s_ringMux);
+}
+
+static void sd_flush() {
+    if (s_sdLen == 0) return;
+    if (SD.cardType() == CARD_NONE) { s_sdLen = 0; s_stats.sd_fail++; return; }
+    File f = SD.open(PKT_TRACE_SD_PATH, FILE_APPEND);
+    if (!f) { s_sdLen = 0; s_stats.sd_fail++; return; }
+    if (f.size() > PKT_TRACE_SD_MAX_BYTES) {
+        // 超过上限：清空重写，避免跟踪文件占满SD
+        f.close();
+        SD.remove(PKT_TRACE_SD_PATH);
+        f = SD.open(PKT_TRACE_SD_PATH, FILE_APPEND);
+        if (!f) { s_sdLen = 0; s_stats.sd_fail++; return; }
+    }
+    if (f.write((const uint8_t*)s_sdBuf, s_sdLen) != s_sdLen) s_stats.sd_fail++;
+    f.close();
+    s_sdLen = 0;
+}
+
+static void sd_write(const char* s, size_t n) {
+    while (n) {
+        size_t room = sizeof(s_sdBuf) - s_sdLen;
+        size_t k = n < room ? n : room;
+        memcpy(s_sdBuf + s_sdLen, s, k);
+        s_sdLen += k; s += k; n -= k;
+        if (s_sdLen == sizeof(s_sdBuf)) sd_flush();
+    }
+}
+
+static void sink_write(const char* s, size_t n) {
+    switch (s_sink) {
+#if ENABLE_LOG2
+        case PTRACE_SINK_SERIAL2: Serial2.write((const uint8_t*)s, n); break;
+#endif
+        case PTRACE_SINK_RING:    ring_write(s, n); break;
+        case PTRACE_SINK_SD:      sd_write(s, n);   break;
+        default: return;
+    }
+    s_stats.bytes_out += n;
+}
+
+static void sink_hex(const uint8_t* d, size_t n) {
+    static const char* HEXCHARS = "0123456789ABCDEF";
+    char line[3 * 16];
+    size_t k = 0;
+    for (size_t i = 0; i < n; ++i) {
+        line[k++] = HEXCHARS[d[i] >> 4];
+        line[k++] = HEXCHARS[d[i] & 0x0F];
+        if (++s_dataCol == 32) {
+            line[k++] = '\n';
+            s_dataCol = 0;
+        } else {
+            line[k++] = ' ';
+        }
+        if (k > sizeof(line) - 3) { sink_write(line, k); k = 0; }
+    }
+    if (k) sink_write(line, k);
+}
+
+static bool sink_usable() {
+#if !ENABLE_LOG2
+    if (s_sink == PTRACE_SINK_SERIAL2) return false;
+#endif
+    return s_sink != PTRACE_SINK_NONE;
+}
+
+void ptrace_set_sink(PktTraceSink sink) {
+    if (s_sink == PTRACE_SINK_SD) sd_flush();
+    s_sink = sink;
+}
+
+void ptrace_set_mode(PktTraceMode mode) { s_mode = mode; }
+void ptrace_set_sample_every(uint16_t n) { s_sampleEvery = n ? n : 1; }
+PktTraceSink ptrace_get_sink() { return s_sink; }
+PktTraceMode ptrace_get_mode() { return s_mode; }
+void ptrace_get_stats(PktTraceStats& out) { out = s_stats; }
+
+size_t ptrace_ring_read(char* out, size_t maxLen) {
+    portENTER_CRITICAL(&s_ringMux);
+    size_t n = s_ringLen < maxLen ? s_ringLen : maxLen;
+    size_t tail = (s_ringHead + PKT_TRACE_RING_SIZE - s_ringLen) % PKT_TRACE_RING_SIZE;
+    for (size_t i = 0; i < n; ++i) out[i] = s_ring[(tail + i) % PKT_TRACE_RING_SIZE];
+    s_ringLen -= n;
+    portEXIT_CRITICAL(&s_ringMux);
+    return n;
+}
+
+void ptrace_begin(const uint8_t* head, size_t len) {
+    s_active = false;
+    g_ptraceData = false;
+    if (s_mode == PTRACE_OFF || !sink_usable()) return;
+
+    s_stats.packets++;
+    s_pktCounter++;
+    s_active = true;
+    g_ptraceData = (s_mode == PTRACE_FULL) ||
+                   (s_mode == PTRACE_SAMPLED && (s_pktCounter % s_sampleEvery) == 0);
+    if (g_ptraceData) s_stats.traced_full++;
+
+    // 摘要行：[PKT] t=<ms> op=R cmd=1d09 pid=0 len=65020
+    char line[80];
+    uint16_t cmd = len >= 19 ? (uint16_t)((head[17] << 8) | head[18]) : 0;
+    uint16_t plen = len >= 4 ? (uint16_t)((head[2] << 8) | head[3]) : 0;
+    int n = snprintf(line, sizeof(line), "[PKT] t=%lu op=%c cmd=%04X pid=%u len=%u\n",
+                     (unsigned long)millis(), len >= 2 ? (char)head[1] : '?',
+                     (unsigned)cmd, len >= 21 ? (unsigned)head[20] : 0u, (unsigned)plen);
+    if (n > 0) sink_write(line, (size_t)n);
+
+    s_dataCol = 0;
+    sink_hex(head, len);
+    if (s_dataCol) { sink_write("\n", 1); s_dataCol = 0; }
+}
+
+void ptrace_data_impl(const uint8_t* data, size_t len) {
+    sink_hex(data, len);
+}
+
+void ptrace_end(uint16_t dataCrc, bool ok) {
+    if (!s_active) return;
+    if (s_dataCol) { sink_write("\n", 1); s_dataCol = 0; }
+    char line[40];
+    int n = snprintf(line, sizeof(line), "[PKT] crc=%04X%s\n", (unsigned)dataCrc, ok ? "" : " SRC_ERR");
+    if (n > 0) sink_write(line, (size_t)n);
+    if (s_sink == PTRACE_SINK_SD) sd_flush();
+    s_active = false;
+    g_ptraceData = false;
+}
+
+#endif
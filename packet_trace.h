@@ -0,0 +1,66 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+// 数据包跟踪：替代在 DTU 串口（Serial）上整包打印HEX
+// 输出到带外的 sink（Serial2 / RAM环形缓冲 / SD跟踪文件），运行时可切换
+// PKT_TRACE_ENABLE=0 时全部钩子编译为空，零开销
+
+typedef enum {
+    PTRACE_SINK_NONE = 0,
+    PTRACE_SINK_SERIAL2,   // 仅 ENABLE_LOG2=1 时可用，否则等同 NONE
+    PTRACE_SINK_RING,      // RAM 环形缓冲，满时覆盖最旧内容
+    PTRACE_SINK_SD         // 追加写 PKT_TRACE_SD_PATH
+} PktTraceSink;
+
+typedef enum {
+    PTRACE_OFF = 0,
+    PTRACE_HEADER,         // 每包只记录协议头、长度与数据CRC
+    PTRACE_SAMPLED,        // 每包记录头；每 N 包完整记录一包
+    PTRACE_FULL            // 每包完整记录
+} PktTraceMode;
+
+typedef struct {
+    uint32_t packets;      // 经过跟踪点的包数
+    uint32_t traced_full;  // 完整记录的包数
+    uint32_t bytes_out;    // 写入 sink 的字节数
+    uint32_t ring_dropped; // 环形缓冲被覆盖的字节数
+    uint32_t sd_fail;      // SD 写失败次数
+} PktTraceStats;
+
+#if PKT_TRACE_ENABLE
+
+void ptrace_set_sink(PktTraceSink sink);
+void ptrace_set_mode(PktTraceMode mode);
+void ptrace_set_sample_every(uint16_t n);   // SAMPLED 模式下每 n 包完整记录一包
+PktTraceSink ptrace_get_sink();
+PktTraceMode ptrace_get_mode();
+void ptrace_get_stats(PktTraceStats& out);
+
+// 取出环形缓冲内容（文本），返回字节数
+size_t ptrace_ring_read(char* out, size_t maxLen);
+
+// 发送路径钩子（由 platform_packet 调用）
+extern bool g_ptraceData;                           // 当前包是否需要记录payload
+void ptrace_begin(const uint8_t* head, size_t len); // header + 头CRC
+void ptrace_data_impl(const uint8_t* data, size_t len);
+void ptrace_end(uint16_t dataCrc, bool ok);
+
+static inline void ptrace_data(const uint8_t* data, size_t len) {
+    if (g_ptraceData) ptrace_data_impl(data, len);
+}
+
+#else
+
+static inline void ptrace_set_sink(PktTraceSink) {}
+static inline void ptrace_set_mode(PktTraceMode) {}
+static inline void ptrace_set_sample_every(uint16_t) {}
+static inline PktTraceSink ptrace_get_sink() { return PTRACE_SINK_NONE; }
+static inline PktTraceMode ptrace_get_mode() { return PTRACE_OFF; }
+static inline void ptrace_get_stats(PktTraceStats& out) { memset(&out, 0, sizeof(out)); }
+static inline size_t ptrace_ring_read(char*, size_t) { return 0; }
+#define ptrace_begin(head, len)   ((void)0)
+#define ptrace_data(data, len)    ((void)0)
+#define ptrace_end(crc, ok)       ((void)0)
+
+#endif
@@ -0,0 +1,79 @@
+#include "photo_sidecar.h"
+#include "crc16.h"
+#include <FS.h>
+#include <SD.h>
+#if PHOTO_SIDECAR_CRC32
+#include <esp_rom_crc.h>
+#endif
+
+void photo_digest_init(PhotoDigest* d) {
+    Crc16Ctx c;
+    crc16_init(&c);
+    d->len = 0;
+    d->crc16 = crc16_final(&c);
+    d->crc32 = 0;
+}
+
+void photo_digest_update(PhotoDigest* d, const uint8_t* data, size_t len) {
+    Crc16Ctx c = { d->crc16 };
+    crc16_update(&c, data, len);
+    d->crc16 = crc16_final(&c);
+#if PHOTO_SIDECAR_CRC32
+    d->crc32 = esp_rom_crc32_le(d->crc32, data, len);
+#endif
+    d->len += len;
+}
+
+bool photo_sidecar_path(const char* photoPath, char* out, size_t outSize) {
+    if (!photoPath || !out) return false;
+    const char* dot = strrchr(photoPath, '.');
+    const char* slash = strrchr(photoPath, '/');
+    size_t stem = (dot && (!slash || dot > slash)) ? (size_t)(dot - photoPath) : strlen(photoPath);
+    if (stem + 5 > outSize) return false;
+    memcpy(out, photoPath, stem);
+    memcpy(out + stem, ".crc", 5);
+    return true;
+}
+
+static uint16_t sidecar_self_crc(const PhotoSidecar* r) {
+    return crc16_modbus((const uint8_t*)r, offsetof(PhotoSidecar, selfCrc));
+}
+
+bool photo_sidecar_write(const char* photoPath, const PhotoDigest* d) {
+    char path[ASYNC_SD_MAX_PATH];
+    if (!photo_sidecar_path(photoPath, path, sizeof(path))) return false;
+
+    PhotoSidecar r;
+    memset(&r, 0, sizeof(r));
+    r.magic = PHOTO_SIDECAR_MAGIC;
+    r.len = d->len;
+    r.crc16 = d->crc16;
+#if PHOTO_SIDECAR_CRC32
+    r.flags |= PHOTO_SIDECAR_HAS_CRC32;
+    r.crc32 = d->crc32;
+#endif
+    r.selfCrc = sidecar_self_crc(&r);
+
+    SD.remove(path);
+    File f = SD.open(path, FILE_WRITE);
+    if (!f) return false;
+    size_t w = f.write((const uint8_t*)&r, sizeof(r));
+    f.close();
+    return w == sizeof(r);
+}
+
+bool photo_sidecar_read(const char* photoPath, PhotoSidecar* out) {
+    char path[ASYNC_SD_MAX_PATH];
+    if (!photo_sidecar_path(photoPath, path, sizeof(path))) return false;
+
+    File f = SD.open(path, FILE_READ);
+    if (!f) return false;
+    PhotoSidecar r;
+    size_t n = f.read((uint8_t*)&r, sizeof(r));
+    f.close();
+    if (n != sizeof(r)) return false;
+    if (r.magic != PHOTO_SIDECAR_MAGIC) return false;
+    if (r.selfCrc != sidecar_self_crc(&r)) return false;
+    *out = r;
+    return true;
+}
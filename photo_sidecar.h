@@ -0,0 +1,35 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+// 图片旁路记录：拍照写卡时一次性算好长度与CRC，存于同名 .crc 文件
+// 上传时直接使用，无需再遍历整张图片；同时可用于校验SD回读是否一致
+typedef struct {
+    uint32_t magic;     // PHOTO_SIDECAR_MAGIC
+    uint32_t len;       // 图片字节数
+    uint16_t crc16;     // CRC-16/MODBUS（init 0xFFFF），即图片段单独的数据CRC
+    uint16_t flags;     // bit0: crc32 有效
+    uint32_t crc32;     // 可选的更强摘要（CRC-32/ISO-HDLC）
+    uint16_t selfCrc;   // 以上字段的 CRC16，防止记录本身损坏
+    uint16_t reserved;
+} PhotoSidecar;
+
+#define PHOTO_SIDECAR_MAGIC      0x31435350UL  // "PSC1"
+#define PHOTO_SIDECAR_HAS_CRC32  0x0001
+
+// 写卡过程中的增量摘要（按块 update，写完 finish）
+typedef struct {
+    uint32_t len;
+    uint16_t crc16;
+    uint32_t crc32;
+} PhotoDigest;
+
+void photo_digest_init(PhotoDigest* d);
+void photo_digest_update(PhotoDigest* d, const uint8_t* data, size_t len);
+
+// 由图片路径得到旁路记录路径（扩展名替换为 .crc）
+bool photo_sidecar_path(const char* photoPath, char* out, size_t outSize);
+
+// 写入/读取旁路记录；读取时校验 magic 与 selfCrc
+bool photo_sidecar_write(const char* photoPath, const PhotoDigest* d);
+bool photo_sidecar_read(const char* photoPath, PhotoSidecar* out);
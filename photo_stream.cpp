@@ -0,0 +1,160 @@
+#include "photo_stream.h"
+#include <FS.h>
+#include <SD.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+
+struct FillReq {
+  uint8_t  idx;
+  uint16_t want;
+};
+
+struct FillDone {
+  uint8_t  idx;
+  uint16_t len;
+};
+
+struct StreamBuf {
+  uint16_t len;
+  uint16_t pos;
+  uint8_t  data[PHOTO_STREAM_CHUNK];
+};
+
+static StreamBuf     s_buf[2];
+static File          s_file;
+static bool          s_open = false;
+static uint32_t      s_toRequest = 0;   // 尚未发出预取请求的字节数
+static uint8_t       s_inflight = 0;    // 已请求未取回的块数
+static int8_t        s_cur = -1;        // 正在消费的缓冲，-1 表示需要取下一块
+static bool          s_err = false;
+
+static QueueHandle_t s_reqQ = nullptr;
+static QueueHandle_t s_doneQ = nullptr;
+static TaskHandle_t  s_task = nullptr;
+
+// 读任务：只在有在途请求时访问 s_file，消费方在在途为0时才打开/关闭文件
+static void reader_task(void*) {
+  FillReq r;
+  for (;;) {
+    if (xQueueReceive(s_reqQ, &r, portMAX_DELAY) != pdTRUE) continue;
+    FillDone d;
+    d.idx = r.idx;
+    d.len = (uint16_t)s_file.read(s_buf[r.idx].data, r.want);
+    xQueueSend(s_doneQ, &d, portMAX_DELAY);
+  }
+}
+
+static bool ensure_task() {
+  if (s_task) return true;
+  if (!s_reqQ) s_reqQ = xQueueCreate(2, sizeof(FillReq));
+  if (!s_doneQ) s_doneQ = xQueueCreate(2, sizeof(FillDone));
+  if (!s_reqQ || !s_doneQ) return false;
+  BaseType_t rc = xTaskCreatePinnedToCore(reader_task, "pstream",
+                                          PHOTO_STREAM_TASK_STACK, nullptr,
+                                          PHOTO_STREAM_TASK_PRIO, &s_task,
+                                          tskNO_AFFINITY);
+  if (rc != pdPASS) s_task = nullptr;
+  return s_task != nullptr;
+}
+
+// 请求把缓冲 idx 填满（异步；无读任务时同步读取）
+static void request_fill(uint8_t idx) {
+  s_buf[idx].len = 0;
+  s_buf[idx].pos = 0;
+  if (s_toRequest == 0) return;
+  uint16_t want = s_toRequest > PHOTO_STREAM_CHUNK ? PHOTO_STREAM_CHUNK : (uint16_t)s_toRequest;
+  s_toRequest -= want;
+  if (s_task) {
+    FillReq r = { idx, want };
+    xQueueSend(s_reqQ, &r, portMAX_DELAY);
+    s_inflight++;
+  } else {
+    s_buf[idx].len = (uint16_t)s_file.read(s_buf[idx].data, want);
+    if (s_buf[idx].len != want) s_err = true;
+  }
+}
+
+// 取回下一块（按请求顺序）
+static bool take_next() {
+  if (s_task) {
+    if (s_inflight == 0) return false;
+    FillDone d;
+    if (xQueueReceive(s_doneQ, &d, pdMS_TO_TICKS(PHOTO_STREAM_READ_TIMEOUT_MS)) != pdTRUE) {
+      s_err = true;
+      return false;
+    }
+    s_inflight--;
+    s_buf[d.idx].len = d.len;
+    s_buf[d.idx].pos = 0;
+    s_cur = (int8_t)d.idx;
+  } else {
+    s_cur = (s_cur < 0) ? 0 : (int8_t)(s_cur ^ 1);
+    if (s_buf[s_cur].len == 0) return false;
+  }
+  return s_buf[s_cur].len > 0;
+}
+
+bool photo_stream_open(const char* path, uint32_t offset, uint32_t len, uint32_t* outLen) {
+  photo_stream_close();
+  s_err = false;
+  s_cur = -1;
+  s_buf[0].len = s_buf[1].len = 0;
+
+  s_file = SD.open(path, FILE_READ);
+  if (!s_file) return false;
+  uint32_t sz = s_file.size();
+  if (offset > sz || (offset && !s_file.seek(offset))) {
+    s_file.close();
+    return false;
+  }
+  uint32_t avail = sz - offset;
+  if (len == 0 || len > avail) len = avail;
+  if (outLen) *outLen = len;
+
+  s_open = true;
+  s_toRequest = len;
+  ensure_task();
+  // 预取两块：发送第一块时第二块已在读
+  request_fill(0);
+  request_fill(1);
+  return true;
+}
+
+size_t photo_stream_read(uint8_t* buf, size_t maxLen) {
+  if (!s_open || s_err) return 0;
+  size_t got = 0;
+  while (got < maxLen) {
+    if (s_cur < 0 || s_buf[s_cur].pos >= s_buf[s_cur].len) {
+      // 当前缓冲已读完：交还给读任务预取后续数据，再取下一块
+      if (s_cur >= 0) request_fill((uint8_t)s_cur);
+      if (!take_next()) break;
+    }
+    StreamBuf& b = s_buf[s_cur];
+    size_t k = b.len - b.pos;
+    if (k > maxLen - got) k = maxLen - got;
+    memcpy(buf + got, b.data + b.pos, k);
+    b.pos += k;
+    got += k;
+  }
+  return got;
+}
+
+void photo_stream_close() {
+  if (!s_open) return;
+  // 等待在途预取完成后再关闭文件，避免读任务访问已关闭的句柄
+  while (s_task && s_inflight) {
+    FillDone d;
+    if (xQueueReceive(s_doneQ, &d, pdMS_TO_TICKS(PHOTO_STREAM_READ_TIMEOUT_MS)) != pdTRUE) break;
+    s_inflight--;
+  }
+  s_file.close();
+  s_open = false;
+  s_toRequest = 0;
+  s_cur = -1;
+}
+
+size_t photo_stream_source(void* ctx, uint8_t* buf, size_t maxLen) {
+  (void)ctx;
+  return photo_stream_read(buf, maxLen);
+}
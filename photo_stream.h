@@ -0,0 +1,21 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+// SD图片流式读取：后台读任务 + 双缓冲预取
+// 消费方发送当前块的同时，读任务把下一块从SD读入另一缓冲，SD读与串口发送重叠；
+// 任意时刻内存中只有两块（2 × PHOTO_STREAM_CHUNK），图片不整体驻留RAM
+// 同一时刻只支持一个流（上传是串行的）
+
+// 打开文件并从 offset 开始预取 len 字节（len=0 表示到文件末尾）
+// 成功时通过 outLen 返回本次可读的字节数
+bool photo_stream_open(const char* path, uint32_t offset, uint32_t len, uint32_t* outLen);
+
+// 读取至多 maxLen 字节，返回实际字节数（0 表示结束或出错）
+size_t photo_stream_read(uint8_t* buf, size_t maxLen);
+
+// 关闭流（等待在途的预取完成后关闭文件）
+void photo_stream_close();
+
+// PacketSourceFn 适配：ctx 未使用
+size_t photo_stream_source(void* ctx, uint8_t* buf, size_t maxLen);
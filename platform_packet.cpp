@@ -2,22 +2,21 @@
 #include "config.h"
 #include "crc16.h"
 #include "uart_utils.h"
+#include "packet_trace.h"
+#include "mipsend.h"
+#include "dtu_tx.h"
+#include "ul_ack.h"
 #include <string.h>
 
 // 头部固定长度
 static const uint16_t PLATFORM_HEADER_LEN = 21;
 
-// 每次 MIPSEND 发送的二进制字节数上限（将被转成 2x HEX 字符）
-// 取 512 字节更容易满足多数模组单行长度限制
-static const size_t MIPSEND_BIN_CHUNK = 128;
-
-// 保留原构建函数（小包可用）；大包发送走流式发送
-size_t build_platform_packet(uint8_t* out,
-                             char opType,
-                             uint16_t cmd,
-                             uint8_t pid,
-                             const uint8_t* payload,
-                             uint16_t payloadLen)
+// 填充协议头（不含头CRC），out 至少 PLATFORM_HEADER_LEN 字节
+static void fillHeader(uint8_t* out,
+                       char opType,
+                       uint16_t cmd,
+                       uint8_t pid,
+                       uint16_t payloadLen)
 {
     out[0]  = '$';
     out[1]  = (uint8_t)opType;
@@ -29,6 +28,17 @@ size_t build_platform_packet(uint8_t* out,
     out[18] = (uint8_t)(cmd & 0xFF);
     out[19] = PLATFORM_DMODEL;
     out[20] = pid;
+}
+
+// 保留原构建函数（小包可用）；大包发送走流式发送
+size_t build_platform_packet(uint8_t* out,
+                             char opType,
+                             uint16_t cmd,
+                             uint8_t pid,
+                             const uint8_t* payload,
+                             uint16_t payloadLen)
+{
+    fillHeader(out, opType, cmd, pid, payloadLen);
 
     uint16_t headCrc = crc16_modbus(out, PLATFORM_HEADER_LEN);
     out[PLATFORM_HEADER_LEN]     = (uint8_t)(headCrc >> 8);
@@ -47,32 +57,111 @@ size_t build_platform_packet(uint8_t* out,
     return offset;
 }
 
-// HEX输出辅助
-static inline void hexByte(uint8_t b) {
-    static const char* HEXCHARS = "0123456789ABCDEF";
-    char tmp[2];
-    tmp[0] = HEXCHARS[(b >> 4) & 0x0F];
-    tmp[1] = HEXCHARS[b & 0x0F];
-    Serial.write((const uint8_t*)tmp, 2);
+// 发送 header + 头CRC（23字节）
+static void sendPacketHead(char opType, uint16_t cmd, uint8_t pid, uint16_t payloadLen) {
+    uint8_t headBlock[PLATFORM_HEADER_LEN + 2];
+    fillHeader(headBlock, opType, cmd, pid, payloadLen);
+    uint16_t headCrc = crc16_modbus(headBlock, PLATFORM_HEADER_LEN);
+    headBlock[PLATFORM_HEADER_LEN]     = (uint8_t)(headCrc >> 8);
+    headBlock[PLATFORM_HEADER_LEN + 1] = (uint8_t)(headCrc & 0xFF);
+    ptrace_begin(headBlock, sizeof(headBlock));
+    mipsend_begin();
+    mipsend_write(headBlock, sizeof(headBlock));
+}
+
+// 发送payload CRC（大端）
+static void sendPacketTail(uint16_t dataCrc) {
+    uint8_t dcrc_be[2] = { (uint8_t)(dataCrc >> 8), (uint8_t)(dataCrc & 0xFF) };
+    mipsend_write(dcrc_be, 2);
+}
+
+static uint32_t s_segCrcMismatch = 0;
+
+uint32_t platform_seg_crc_mismatch_count() {
+    return s_segCrcMismatch;
 }
 
-static void hexWriteBuf(const uint8_t* data, size_t len) {
-    for (size_t i = 0; i < len; ++i) hexByte(data[i]);
+// 发送一个内存段，同时累加数据CRC（crc 为空时只发送不计算）
+static void sendSegMem(Crc16Ctx* crc, const uint8_t* data, size_t len) {
+    if (crc) crc16_update(crc, data, len);
+    ptrace_data(data, len);
+    mipsend_write(data, len);
 }
 
-// 发送一段 HEX 数据（包装成一条 AT+MIPSEND=0,0,<HEX>\r\n）
-// 注意：多次调用将依次在 TCP 上连续发送，平台协议数据在流上保持连续
-static void mipSendHex(const uint8_t* data, size_t len) {
+// 从数据源拉取一个段边读边发；数据源提前结束时用0补齐，返回 false
+static bool sendSegSource(Crc16Ctx* crc, PacketSourceFn src, void* srcCtx, size_t len) {
+    uint8_t buf[MIPSEND_BIN_CHUNK];
+    bool ok = (src != nullptr);
     while (len) {
-        size_t n = len > MIPSEND_BIN_CHUNK ? MIPSEND_BIN_CHUNK : len;
-        Serial.write((const uint8_t*)"AT+MIPSEND=0,0,", 15);
-        hexWriteBuf(data, n);
-        Serial.write((const uint8_t*)"\r\n", 2);
-        data += n;
-        len  -= n;
-        // 适度让出 CPU/给模组时间处理，避免串口拥塞
-        delay(2);
+        size_t want = len > sizeof(buf) ? sizeof(buf) : len;
+        size_t n = ok ? src(srcCtx, buf, want) : 0;
+        if (n > want) n = want;
+        if (n < want) {
+            ok = false;
+            memset(buf + n, 0, want - n);
+        }
+        if (crc) crc16_update(crc, buf, want);
+        ptrace_data(buf, want);
+        mipsend_write(buf, want);
+        len -= want;
     }
+    return ok;
+}
+
+// 分散/聚集流式发送：协议头 → 各段 → 数据CRC，payload 只遍历一遍且不做拼接拷贝
+// 数据源提前结束时用0补齐声明长度以保持TCP流上的分帧，
+// 并发送取反的数据CRC，使平台丢弃该包
+bool sendPlatformPacketSegs(char opType,
+                            uint16_t cmd,
+                            uint8_t pid,
+                            const PacketSeg* segs,
+                            size_t segCount)
+{
+    uint32_t total = 0;
+    for (size_t i = 0; i < segCount; ++i) total += segs[i].len;
+    if (total > 0xFFFF) return false;
+
+    sendPacketHead(opType, cmd, pid, (uint16_t)total);
+    if (total == 0) {
+        ptrace_end(0, true);
+        return mipsend_end();
+    }
+
+    Crc16Ctx crc;
+    crc16_init(&crc);
+    bool ok = true;
+    for (size_t i = 0; i < segCount; ++i) {
+        const PacketSeg& sg = segs[i];
+        if (sg.len == 0) continue;
+        if (!sg.hasCrc) {
+            if (sg.data) sendSegMem(&crc, sg.data, sg.len);
+            else if (!sendSegSource(&crc, sg.src, sg.srcCtx, sg.len)) ok = false;
+            continue;
+        }
+        // 段CRC已知：整包CRC直接拼接；校验开启时另算一份段CRC比对回读数据
+#if PHOTO_SIDECAR_VERIFY
+        Crc16Ctx segCrc;
+        crc16_init(&segCrc);
+        Crc16Ctx* pc = &segCrc;
+#else
+        Crc16Ctx* pc = nullptr;
+#endif
+        if (sg.data) sendSegMem(pc, sg.data, sg.len);
+        else if (!sendSegSource(pc, sg.src, sg.srcCtx, sg.len)) ok = false;
+#if PHOTO_SIDECAR_VERIFY
+        if (ok && crc16_final(&segCrc) != sg.crc) {
+            s_segCrcMismatch++;
+            ok = false;
+        }
+#endif
+        crc.crc = crc16_combine(crc16_final(&crc), sg.crc, sg.len);
+    }
+    uint16_t dataCrc = crc16_final(&crc);
+    if (!ok) dataCrc = (uint16_t)~dataCrc;
+    sendPacketTail(dataCrc);
+    ptrace_end(dataCrc, ok);
+    if (!mipsend_end()) ok = false;
+    return ok;
 }
 
 // 分块流式发送平台数据包：避免超长单行 AT，支持大payload（≤65K）
@@ -82,48 +171,29 @@ void sendPlatformPacket(char opType,
                         const uint8_t* payload,
                         uint16_t payloadLen)
 {
-    // 1) 组装头部（不含头CRC）
-    uint8_t header[PLATFORM_HEADER_LEN];
-    header[0]  = '$';
-    header[1]  = (uint8_t)opType;
-    header[2]  = (uint8_t)(payloadLen >> 8);
-    header[3]  = (uint8_t)(payloadLen & 0xFF);
-    for (int i = 0; i < 12; ++i) header[4 + i] = (uint8_t)g_device_sn[i];
-    header[16] = PLATFORM_VER;
-    header[17] = (uint8_t)(cmd >> 8);
-    header[18] = (uint8_t)(cmd & 0xFF);
-    header[19] = PLATFORM_DMODEL;
-    header[20] = pid;
-
-    // 2) 计算CRC
-    uint16_t headCrc = crc16_modbus(header, PLATFORM_HEADER_LEN);
-    uint16_t dataCrc = 0;
-    if (payloadLen > 0 && payload) {
-        dataCrc = crc16_modbus(payload, payloadLen);
-    }
-
-    // 3) 先发送 header + 头CRC（23字节）
-    uint8_t headBlock[PLATFORM_HEADER_LEN + 2];
-    memcpy(headBlock, header, PLATFORM_HEADER_LEN);
-    headBlock[PLATFORM_HEADER_LEN]     = (uint8_t)(headCrc >> 8);
-    headBlock[PLATFORM_HEADER_LEN + 1] = (uint8_t)(headCrc & 0xFF);
-    mipSendHex(headBlock, sizeof(headBlock));
+    PacketSeg seg = { payload, payload ? payloadLen : 0u, nullptr, nullptr, false, 0 };
+    sendPlatformPacketSegs(opType, cmd, pid, &seg, 1);
+}
 
-    // 4) 分块发送 payload（如有）
-    if (payloadLen > 0 && payload) {
-        mipSendHex(payload, payloadLen);
-        // 5) 发送payload CRC（大端）
-        uint8_t dcrc_be[2] = { (uint8_t)(dataCrc >> 8), (uint8_t)(dataCrc & 0xFF) };
-        mipSendHex(dcrc_be, 2);
-    }
+// 从数据源拉取 payload 边读边发（RAM/SD文件/相机缓冲均可）
+bool sendPlatformPacketFrom(char opType,
+                            uint16_t cmd,
+                            uint8_t pid,
+                            uint16_t payloadLen,
+                            PacketSourceFn src,
+                            void* srcCtx)
+{
+    PacketSeg seg = { nullptr, src ? payloadLen : 0u, src, srcCtx, false, 0 };
+    return sendPlatformPacketSegs(opType, cmd, pid, &seg, 1);
 }
 
-void sendHeartbeat() {
-    sendPlatformPacket('R', CMD_HEARTBEAT_REQ, 0, nullptr, 0);
+bool sendHeartbeat() {
+    return dtu_tx_submit_packet(TX_PRIO_HIGH, 'R', CMD_HEARTBEAT_REQ, ul_ack_next_seq(), nullptr, 0);
 }
 
 // year字段2字节，高位在前，payload长度14
-void sendRealtimeMonitorData(
+uint16_t buildRealtimeMonitorPayload(
+    uint8_t* payload,
     uint16_t year,
     uint8_t month,
     uint8_t day,
@@ -134,7 +204,7 @@ void sendRealtimeMonitorData(
     const uint8_t* exceptionStatus,
     uint8_t waterStatus
 ) {
-    uint8_t payload[14] = {0};
+    memset(payload, 0, REALTIME_PAYLOAD_LEN);
     payload[0] = (uint8_t)(year >> 8);     // 高字节
     payload[1] = (uint8_t)(year & 0xFF);   // 低字节
     payload[2] = month;
@@ -146,10 +216,49 @@ void sendRealtimeMonitorData(
     payload[8] = exceptionStatus ? exceptionStatus[0] : 0; // 只用1字节
     // payload[9-12] 默认0
     payload[13] = waterStatus;
-    sendPlatformPacket('R', 0x1d00, 0, payload, sizeof(payload));
+    return REALTIME_PAYLOAD_LEN;
+}
+
+bool sendStoredPacket(uint16_t cmd, const uint8_t* payload, uint16_t len) {
+    return ul_ack_send_packet(TX_PRIO_NORMAL, 'R', cmd, payload, len);
 }
 
-void sendMonitorEventUpload(
+// 事件上传元数据段（20字节，year占2字节，imageLen大端）
+static void fillEventMeta(uint8_t* meta,
+                          uint16_t year, uint8_t month, uint8_t day,
+                          uint8_t hour, uint8_t minute, uint8_t second,
+                          uint8_t triggerCond,
+                          float realtimeValue, float thresholdValue,
+                          uint32_t imageLen)
+{
+    meta[0] = (uint8_t)(year >> 8);
+    meta[1] = (uint8_t)(year & 0xFF);
+    meta[2] = month;
+    meta[3] = day;
+    meta[4] = hour;
+    meta[5] = minute;
+    meta[6] = second;
+    meta[7] = triggerCond;
+    memcpy(meta + 8, &realtimeValue, 4);
+    memcpy(meta + 12, &thresholdValue, 4);
+    // ---- 大端序的imageLen ----
+    meta[16] = (uint8_t)((imageLen >> 24) & 0xFF);
+    meta[17] = (uint8_t)((imageLen >> 16) & 0xFF);
+    meta[18] = (uint8_t)((imageLen >> 8) & 0xFF);
+    meta[19] = (uint8_t)(imageLen & 0xFF);
+}
+
+// 元数据段 + 图片段：图片段直接引用调用方缓冲或数据源，不做拷贝
+static bool sendEventSegs(const uint8_t* meta, const PacketSeg& image, uint8_t pid) {
+    PacketSeg segs[2] = {
+        { meta, 20, nullptr, nullptr, false, 0 },
+        image,
+    };
+    // 上传内容由 packet_trace 在发送路径上带外记录，不再在DTU串口打印HEX
+    return sendPlatformPacketSegs('R', CMD_EVENT_UPLOAD, pid, segs, 2);
+}
+
+bool sendMonitorEventUpload(
     uint16_t year,
     uint8_t month,
     uint8_t day,
@@ -160,61 +269,108 @@ void sendMonitorEventUpload(
     float realtimeValue,
     float thresholdValue,
     const uint8_t* imageData,
-    uint32_t imageLen
+    uint32_t imageLen,
+    uint8_t pid
 ) {
-    if (imageLen > 65000) imageLen = 65000;
-    uint32_t totalLen = 20 + imageLen; // year占2字节
-    uint8_t* payload = (uint8_t*)malloc(totalLen);
-    if (!payload) return;
+    if (imageLen > PHOTO_SINGLE_MAX) imageLen = PHOTO_SINGLE_MAX;
+    if (!imageData) imageLen = 0;
 
-    payload[0] = (uint8_t)(year >> 8);
-    payload[1] = (uint8_t)(year & 0xFF);
-    payload[2] = month;
-    payload[3] = day;
-    payload[4] = hour;
-    payload[5] = minute;
-    payload[6] = second;
-    payload[7] = triggerCond;
-    memcpy(payload + 8, &realtimeValue, 4);
-    memcpy(payload + 12, &thresholdValue, 4);
-    // ---- 大端序的imageLen ----
-    payload[16] = (uint8_t)((imageLen >> 24) & 0xFF);
-    payload[17] = (uint8_t)((imageLen >> 16) & 0xFF);
-    payload[18] = (uint8_t)((imageLen >> 8) & 0xFF);
-    payload[19] = (uint8_t)(imageLen & 0xFF);
-    // -------------------------
-    if (imageLen > 0 && imageData) {
-        memcpy(payload + 20, imageData, imageLen);
-    }
-    sendPlatformPacket('R', 0x1d09, 0, payload, (uint16_t)totalLen);
-
-    // ===== 新增：上传内容串口HEX打印 =====
-    size_t pktLen = 21 + 2 + totalLen + (totalLen > 0 ? 2 : 0);
-    uint8_t* pkt = (uint8_t*)malloc(pktLen);
-    if (pkt) {
-        size_t n = build_platform_packet(pkt, 'R', 0x1d09, 0, payload, (uint16_t)totalLen);
-        // 打印HEX，每字节空格，每100字节换行
-        for (size_t i = 0; i < n; ++i) {
-            if (i > 0) Serial.print(' ');
-            if (i > 0 && (i % 50 == 0)) Serial.println();
-            uint8_t b = pkt[i];
-            if (b < 16) Serial.print('0');
-            Serial.print(b, HEX);
-        }
-        Serial.println();
-        free(pkt);
-    }
-    // ===== END =====
+    uint8_t meta[20];
+    fillEventMeta(meta, year, month, day, hour, minute, second,
+                  triggerCond, realtimeValue, thresholdValue, imageLen);
+    PacketSeg image = { imageData, imageLen, nullptr, nullptr, false, 0 };
+    return sendEventSegs(meta, image, pid);
+}
 
-    free(payload);
+bool sendMonitorEventUploadFrom(
+    uint16_t year,
+    uint8_t month,
+    uint8_t day,
+    uint8_t hour,
+    uint8_t minute,
+    uint8_t second,
+    uint8_t triggerCond,
+    float realtimeValue,
+    float thresholdValue,
+    PacketSourceFn imageSrc,
+    void* imageSrcCtx,
+    uint32_t imageLen,
+    const uint16_t* imageCrc,
+    uint8_t pid
+) {
+    // 预计算CRC只对应完整图片，被截断或无数据源时不可用
+    if (imageLen > PHOTO_SINGLE_MAX) { imageLen = PHOTO_SINGLE_MAX; imageCrc = nullptr; }
+    if (!imageSrc) { imageLen = 0; imageCrc = nullptr; }
+
+    uint8_t meta[20];
+    fillEventMeta(meta, year, month, day, hour, minute, second,
+                  triggerCond, realtimeValue, thresholdValue, imageLen);
+    PacketSeg image = { nullptr, imageLen, imageSrc, imageSrcCtx,
+                        imageCrc != nullptr, imageCrc ? *imageCrc : (uint16_t)0 };
+    return sendEventSegs(meta, image, pid);
+}
+
+static_assert(PHOTO_SINGLE_MAX + 20 <= 0xFFFF, "PHOTO_SINGLE_MAX too large");
+
+static const uint16_t EVENT_FRAG_HDR_LEN = 30;
+static_assert(PHOTO_FRAG_SIZE + EVENT_FRAG_HDR_LEN <= 0xFFFF, "PHOTO_FRAG_SIZE too large");
+
+uint16_t event_frag_count(uint32_t imageLen) {
+    return (uint16_t)((imageLen + PHOTO_FRAG_SIZE - 1) / PHOTO_FRAG_SIZE);
+}
+
+bool sendMonitorEventFragment(
+    uint16_t year,
+    uint8_t month,
+    uint8_t day,
+    uint8_t hour,
+    uint8_t minute,
+    uint8_t second,
+    uint8_t triggerCond,
+    float realtimeValue,
+    float thresholdValue,
+    uint32_t imageLen,
+    uint16_t fragIdx,
+    PacketSourceFn imageSrc,
+    void* imageSrcCtx,
+    const uint16_t* fragCrc,
+    uint8_t pid
+) {
+    uint16_t fragCount = event_frag_count(imageLen);
+    if (!imageSrc || fragIdx >= fragCount) return false;
+
+    uint32_t offset = (uint32_t)fragIdx * PHOTO_FRAG_SIZE;
+    uint32_t fragLen = imageLen - offset;
+    if (fragLen > PHOTO_FRAG_SIZE) fragLen = PHOTO_FRAG_SIZE;
+
+    uint8_t hdr[EVENT_FRAG_HDR_LEN];
+    fillEventMeta(hdr, year, month, day, hour, minute, second,
+                  triggerCond, realtimeValue, thresholdValue, imageLen);
+    hdr[20] = (uint8_t)(fragIdx >> 8);
+    hdr[21] = (uint8_t)(fragIdx & 0xFF);
+    hdr[22] = (uint8_t)(fragCount >> 8);
+    hdr[23] = (uint8_t)(fragCount & 0xFF);
+    hdr[24] = (uint8_t)((offset >> 24) & 0xFF);
+    hdr[25] = (uint8_t)((offset >> 16) & 0xFF);
+    hdr[26] = (uint8_t)((offset >> 8) & 0xFF);
+    hdr[27] = (uint8_t)(offset & 0xFF);
+    hdr[28] = (uint8_t)(fragLen >> 8);
+    hdr[29] = (uint8_t)(fragLen & 0xFF);
+
+    PacketSeg segs[2] = {
+        { hdr, sizeof(hdr), nullptr, nullptr, false, 0 },
+        { nullptr, fragLen, imageSrc, imageSrcCtx,
+          fragCrc != nullptr, fragCrc ? *fragCrc : (uint16_t)0 },
+    };
+    return sendPlatformPacketSegs('R', CMD_EVENT_FRAG_UPLOAD, pid, segs, 2);
 }
 
-void sendTimeSyncRequest() 
+bool sendTimeSyncRequest() 
 {
-    sendPlatformPacket('R', CMD_TIME_SYNC_REQ, 0, nullptr, 0);
+    return dtu_tx_submit_packet(TX_PRIO_HIGH, 'R', CMD_TIME_SYNC_REQ, ul_ack_next_seq(), nullptr, 0);
 }
 
-void sendStartupStatusReport
+bool sendStartupStatusReport
 (
     uint16_t year,
     uint8_t month,
@@ -251,10 +407,10 @@ void sendStartupStatusReport
     memcpy(payload + 17, model, len);
     payload[17 + len] = 0; // 保证结尾0
 
-    sendPlatformPacket('R', 0x0002, 0, payload, sizeof(payload));
+    return ul_ack_send_packet(TX_PRIO_HIGH, 'R', 0x0002, payload, sizeof(payload));
 }
 
-void sendSimInfoUpload(
+bool sendSimInfoUpload(
     uint16_t year,
     uint8_t month,
     uint8_t day,
@@ -283,5 +439,10 @@ void sendSimInfoUpload(
     memcpy(payload + 8 + iccid_len + 1, imsi, imsi_len);
     payload[8 + iccid_len + 1 + imsi_len] = signal;
     uint16_t paylen = 8 + iccid_len + 1 + imsi_len + 1;
-    sendPlatformPacket('R', 0x0007, 0, payload, paylen);
-}
\ No newline at end of file
+    return ul_ack_send_packet(TX_PRIO_NORMAL, 'R', 0x0007, payload, paylen);
+}
+
+bool sendLinkStatsUpload(const uint8_t* payload, uint16_t len) {
+    log2("[PKT] sendLinkStatsUpload called.");
+    return ul_ack_send_packet(TX_PRIO_NORMAL, 'R', CMD_LINK_STATS_UP, payload, len);
+}
@@ -10,16 +10,57 @@ size_t build_platform_packet(uint8_t* out,
                              const uint8_t* payload,
                              uint16_t payloadLen);
 
-// 发送平台数据包
+// 发送平台数据包（同步，调用方须持链路锁；业务包经 dtu_tx 入队）
 void sendPlatformPacket(char opType,
                         uint16_t cmd,
                         uint8_t pid,
                         const uint8_t* payload,
                         uint16_t payloadLen);
 
-void sendHeartbeat();
+// 载荷数据源：向 buf 写入至多 maxLen 字节，返回实际字节数（<maxLen 视为数据源出错）
+typedef size_t (*PacketSourceFn)(void* ctx, uint8_t* buf, size_t maxLen);
 
-void sendRealtimeMonitorData(
+// 流式发送平台数据包：payload 由数据源按块拉取，边发送边计算数据CRC（单遍）
+// 返回 false 表示数据源未能提供 payloadLen 字节（该包以错误CRC结尾，平台将丢弃）
+bool sendPlatformPacketFrom(char opType,
+                            uint16_t cmd,
+                            uint8_t pid,
+                            uint16_t payloadLen,
+                            PacketSourceFn src,
+                            void* srcCtx);
+
+// 分散/聚集（iovec式）载荷段：data 非空时直接发送该内存，否则从 src 拉取 len 字节
+// 协议头与CRC尾由发送函数生成，调用方只描述 payload 的各段（元数据、图片等），无需拼接拷贝
+// hasCrc=true 时 crc 为该段单独的 CRC-16/MODBUS（如写卡时记录的图片CRC），
+// 整包数据CRC由 crc16_combine 拼出；PHOTO_SIDECAR_VERIFY 开启时发送过程中顺带校验回读数据
+typedef struct {
+    const uint8_t* data;
+    uint32_t       len;
+    PacketSourceFn src;
+    void*          srcCtx;
+    bool           hasCrc;
+    uint16_t       crc;
+} PacketSeg;
+
+// 按段顺序发送一个平台数据包；各段总长须 ≤ 65535，否则不发送并返回 false
+bool sendPlatformPacketSegs(char opType,
+                            uint16_t cmd,
+                            uint8_t pid,
+                            const PacketSeg* segs,
+                            size_t segCount);
+
+// 预计算CRC与实际发送数据不一致的累计次数（SD回读损坏或旁路记录过期）
+uint32_t platform_seg_crc_mismatch_count();
+
+// 以下小包（心跳、实时数据、校时、开机上报、SIM信息）只入发送队列，立即返回；
+// 返回 false 表示队列满或确认窗口满（背压），调用方下一轮再试。
+// pid 携带上行序号（见 ul_ack）：心跳、校时只带序号，其余为可靠包，未确认时自动重传
+bool sendHeartbeat();
+
+// 实时数据 payload（REALTIME_PAYLOAD_LEN 字节）：离线时记入日志，重连后原样补传
+#define REALTIME_PAYLOAD_LEN 14
+uint16_t buildRealtimeMonitorPayload(
+    uint8_t* payload,
     uint16_t year,
     uint8_t month,
     uint8_t day,
@@ -31,7 +72,10 @@ void sendRealtimeMonitorData(
     uint8_t waterStatus
 );
 
-void sendMonitorEventUpload(
+// 事件上传为同步发送（边读边发），须在发送任务的作业中调用（见 dtu_tx_submit_job）
+// pid 为 ul_ack_open 分配的序号，重传时沿用原序号
+// 返回 false 表示未能完整发出（链路不可用或写入失败），事件须保留待重发
+bool sendMonitorEventUpload(
     uint16_t year,
     uint8_t month,
     uint8_t day,
@@ -42,13 +86,58 @@ void sendMonitorEventUpload(
     float realtimeValue,
     float thresholdValue,
     const uint8_t* imageData,
-    uint32_t imageLen
+    uint32_t imageLen,
+    uint8_t pid = 0
+);
+
+// 同上，图片由数据源按块拉取（如SD文件），不需要整张图片驻留内存
+// 返回 false 表示数据源读取失败（该包以错误CRC结尾，平台将丢弃）
+bool sendMonitorEventUploadFrom(
+    uint16_t year,
+    uint8_t month,
+    uint8_t day,
+    uint8_t hour,
+    uint8_t minute,
+    uint8_t second,
+    uint8_t triggerCond,
+    float realtimeValue,
+    float thresholdValue,
+    PacketSourceFn imageSrc,
+    void* imageSrcCtx,
+    uint32_t imageLen,
+    const uint16_t* imageCrc = nullptr,  // 非空：图片的预计算CRC（来自旁路记录）
+    uint8_t pid = 0
 );
 
-void sendTimeSyncRequest();
+// 分片事件上传（cmd 0x1d0a）：图片 > PHOTO_SINGLE_MAX 字节时按 PHOTO_FRAG_SIZE 拆片，每片一个平台包
+// payload = 事件元数据(20，imageLen为整图长度) + 片头(10) + 图片片段
+// 片头：fragIdx(2) fragCount(2) offset(4) fragLen(2)，均为大端；每片各自带数据CRC
+uint16_t event_frag_count(uint32_t imageLen);
+
+// 发送第 fragIdx 片；数据源须从该片 offset 处开始提供数据
+// fragCrc 非空时为该片图片数据的预计算CRC（发送中顺带校验，见 PacketSeg.hasCrc）
+bool sendMonitorEventFragment(
+    uint16_t year,
+    uint8_t month,
+    uint8_t day,
+    uint8_t hour,
+    uint8_t minute,
+    uint8_t second,
+    uint8_t triggerCond,
+    float realtimeValue,
+    float thresholdValue,
+    uint32_t imageLen,
+    uint16_t fragIdx,
+    PacketSourceFn imageSrc,
+    void* imageSrcCtx,
+    const uint16_t* fragCrc = nullptr,
+    uint8_t pid = 0
+);
+
+bool sendTimeSyncRequest();
 
 // ================= 新增：开机状态上报接口和状态码 =================
-void sendStartupStatusReport(
+bool sendStartupStatusReport(
     uint16_t year,
     uint8_t month,
     uint8_t day,
@@ -74,7 +163,7 @@ void sendStartupStatusReport(
 #define STATUS_UPGRADE_FILE_TOO_BIG 108
 #define STATUS_UPGRADE_SUCCESS_BUT_FAIL_MANY_TIMES 109
 
-void sendSimInfoUpload(
+bool sendSimInfoUpload(
     uint16_t year,
     uint8_t month,
     uint8_t day,
@@ -86,3 +175,9 @@ void sendSimInfoUpload(
     uint8_t signal
 );
 
+// 按 cmd 发送已编码好的小包（可靠包）：实时数据（含批量包）
+bool sendStoredPacket(uint16_t cmd, const uint8_t* payload, uint16_t len);
+
+// 链路统计上报（payload 由 link_stats_encode 生成）
+bool sendLinkStatsUpload(const uint8_t* payload, uint16_t len);
+
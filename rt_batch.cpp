@@ -0,0 +1,82 @@
+#include "rt_batch.h"
+
+struct RtSample {
+  uint32_t epoch;
+  uint8_t  exc;
+  uint8_t  water;
+};
+
+static RtSample     s_buf[RT_BATCH_CAP];
+static uint8_t      s_count = 0;
+static PlatformTime s_firstTime;
+static uint32_t     s_firstMs = 0;
+static bool         s_edge = false;
+static RtBatchStats s_st;
+
+bool rt_batch_add(const PlatformTime& t, uint32_t epoch, uint8_t exceptionStatus,
+                  uint8_t waterStatus, bool edge, uint32_t nowMs) {
+  if (s_count >= RT_BATCH_CAP) {
+    s_st.dropped++;
+    return false;
+  }
+  if (s_count == 0) {
+    s_firstTime = t;
+    s_firstMs = nowMs;
+  }
+  RtSample& s = s_buf[s_count++];
+  s.epoch = epoch;
+  s.exc = exceptionStatus;
+  s.water = waterStatus;
+  if (edge) s_edge = true;
+  s_st.samples++;
+  return true;
+}
+
+RtFlushReason rt_batch_due(uint32_t nowMs) {
+  if (s_count == 0) return RT_FLUSH_NONE;
+  if (s_edge) return RT_FLUSH_EDGE;
+  if (s_count >= REALTIME_BATCH_SIZE) return RT_FLUSH_COUNT;
+  if (nowMs - s_firstMs >= REALTIME_BATCH_MAX_AGE_MS) return RT_FLUSH_AGE;
+  return RT_FLUSH_NONE;
+}
+
+uint16_t rt_batch_encode(uint8_t* out, size_t maxLen) {
+  uint16_t len = RT_BATCH_HDR_LEN + (uint16_t)s_count * RT_BATCH_SAMPLE_LEN;
+  if (s_count == 0 || maxLen < len) return 0;
+  const PlatformTime& t = s_firstTime;
+  out[0] = (uint8_t)(t.year >> 8);
+  out[1] = (uint8_t)(t.year & 0xFF);
+  out[2] = t.month;
+  out[3] = t.day;
+  out[4] = t.hour;
+  out[5] = t.minute;
+  out[6] = t.second;
+  out[7] = 0;          // 数据格式
+  out[8] = s_count;
+  uint8_t* p = out + RT_BATCH_HDR_LEN;
+  uint32_t prev = s_buf[0].epoch;
+  for (uint8_t i = 0; i < s_count; ++i) {
+    uint32_t d = s_buf[i].epoch - prev;
+    if (d > 0xFFFF) d = 0xFFFF;
+    prev = s_buf[i].epoch;
+    p[0] = (uint8_t)(d >> 8);
+    p[1] = (uint8_t)(d & 0xFF);
+    p[2] = s_buf[i].exc;
+    p[3] = s_buf[i].water;
+    p += RT_BATCH_SAMPLE_LEN;
+  }
+  return len;
+}
+
+void rt_batch_sent(RtFlushReason why) {
+  s_count = 0;
+  s_edge = false;
+  s_st.packets++;
+  if (why == RT_FLUSH_COUNT) s_st.by_count++;
+  else if (why == RT_FLUSH_AGE) s_st.by_age++;
+  else if (why == RT_FLUSH_EDGE) s_st.by_edge++;
+}
+
+void rt_batch_get_stats(RtBatchStats& out) {
+  out = s_st;
+}
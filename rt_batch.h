@@ -0,0 +1,48 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+#include "uart_utils.h"
+
+// 实时数据批量上报：按周期采样的状态先在内存中累积，凑满 REALTIME_BATCH_SIZE 条、
+// 首条已等待 REALTIME_BATCH_MAX_AGE_MS 或告警状态变化（沿）时打成一个包（CMD_REALTIME_BATCH）。
+// 每条样本只占 4 字节，协议头、CRC 与 AT 封装按批分摊，模组唤醒次数同比减少
+//
+// payload（大端）：首条时间7 | 数据格式1 | 条数1 | 条数 × [与上一条的间隔秒2 | 异常状态1 | 水浸状态1]
+// 首条的间隔为 0；间隔超过 0xFFFF 秒时截断
+
+#define RT_BATCH_HDR_LEN     9
+#define RT_BATCH_SAMPLE_LEN  4
+#define RT_BATCH_CAP         ((DTU_TX_INLINE_MAX - RT_BATCH_HDR_LEN) / RT_BATCH_SAMPLE_LEN)
+
+static_assert(REALTIME_BATCH_SIZE <= RT_BATCH_CAP, "REALTIME_BATCH_SIZE exceeds packet capacity");
+
+enum RtFlushReason : uint8_t {
+  RT_FLUSH_NONE = 0,
+  RT_FLUSH_COUNT,
+  RT_FLUSH_AGE,
+  RT_FLUSH_EDGE,
+};
+
+struct RtBatchStats {
+  uint32_t samples = 0;
+  uint32_t dropped = 0;       // 批满且发不出去时丢弃的样本
+  uint32_t packets = 0;       // 已发出（或记入离线日志）的批
+  uint32_t by_count = 0;
+  uint32_t by_age = 0;
+  uint32_t by_edge = 0;
+};
+
+// 加入一条样本；edge=true 表示告警状态相对上一条发生变化，需立即发送。返回 false 表示批已满被丢弃
+bool rt_batch_add(const PlatformTime& t, uint32_t epoch, uint8_t exceptionStatus,
+                  uint8_t waterStatus, bool edge, uint32_t nowMs);
+
+// 是否应发送，返回原因
+RtFlushReason rt_batch_due(uint32_t nowMs);
+
+// 编码当前批，返回长度（无样本返回 0）
+uint16_t rt_batch_encode(uint8_t* out, size_t maxLen);
+
+// 当前批已发出：清空并计数
+void rt_batch_sent(RtFlushReason why);
+
+void rt_batch_get_stats(RtBatchStats& out);
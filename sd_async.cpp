@@ -1,5 +1,6 @@
 #include "sd_async.h"
 #include "config.h"
+#include "photo_sidecar.h"
 #include <SD.h>
 #include <FS.h>
 
@@ -34,6 +35,7 @@ struct Job {
   char     path[ASYNC_SD_MAX_PATH];
   PoolBlk* blk;
   bool     is_first;  // 第一块：会先 remove 旧文件
+  bool     is_last;   // 最后一块：写完后生成CRC旁路记录
 };
 
 static QueueHandle_t  g_q = nullptr;
@@ -127,6 +129,10 @@ static bool write_chunk(const char* path, const uint8_t* data, size_t len, bool
 
 static void writer_task(void*){
   Job j{};
+#if PHOTO_SIDECAR_ENABLE
+  PhotoDigest dg;
+  bool dg_ok = false;
+#endif
   while(g_running){
     if(xQueueReceive(g_q, &j, pdMS_TO_TICKS(100)) != pdTRUE){
       continue;
@@ -135,6 +141,18 @@ static void writer_task(void*){
     g_writer_busy = true;
     bool ok = write_chunk(j.path, j.blk->data, j.blk->len, j.is_first);
     if(ok) g_wr_ok++; else g_wr_fail++;
+#if PHOTO_SIDECAR_ENABLE
+    // 同一文件的各块按顺序到达：写卡时顺带累加摘要，最后一块写完生成旁路记录
+    if(j.is_first){ photo_digest_init(&dg); dg_ok = true; }
+    if(dg_ok){
+      photo_digest_update(&dg, j.blk->data, j.blk->len);
+      if(!ok) dg_ok = false;
+    }
+    if(j.is_last && dg_ok){
+      photo_sidecar_write(j.path, &dg);
+      dg_ok = false;
+    }
+#endif
     pool_give(j.blk);
     g_writer_busy = false;
   }
@@ -208,6 +226,7 @@ bool sd_async_submit(const char* path, const uint8_t* data, size_t len, uint32_t
     j.path[ASYNC_SD_MAX_PATH-1] = '\0';
     j.blk = b;
     j.is_first = first;
+    j.is_last = (remain == chunk);
     first = false;
 
     if(!q_send(j, timeout_ms)){
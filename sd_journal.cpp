@@ -0,0 +1,166 @@
+#include "sd_journal.h"
+#include "crc16.h"
+#include "uart_utils.h"
+#include <FS.h>
+#include <SD.h>
+#include <Preferences.h>
+
+#define JRNL_NVS_NS   "jrnl"
+#define JRNL_NVS_KEY  "off"
+#define JRNL_MAGIC    0xA5
+#define JRNL_HDR_LEN  4
+#define JRNL_REC_MAX  (JRNL_HDR_LEN + JRNL_DATA_MAX + 2)
+
+static bool     s_ready = false;
+static uint32_t s_cursor = 0;     // 已补传到的偏移
+static uint32_t s_stored = 0;     // NVS 中的游标
+static uint32_t s_size = 0;       // 文件大小（本模块是唯一写入方）
+static uint16_t s_peekLen = 0;    // peek 到的记录总长，0=无
+static uint32_t s_burstMs = 0;    // 本轮补传开始时间（速率统计）
+static uint32_t s_burstBytes = 0;
+static JournalStats s_st;
+
+static void store_cursor(uint32_t off) {
+  if (off == s_stored) return;
+  Preferences p;
+  if (!p.begin(JRNL_NVS_NS, false)) return;
+  if (off == 0) p.remove(JRNL_NVS_KEY);
+  else p.putUInt(JRNL_NVS_KEY, off);
+  p.end();
+  s_stored = off;
+}
+
+// 全部补传完：删除文件，下一次离线从头写
+static void reset_file() {
+  SD.remove(JOURNAL_PATH);
+  s_size = 0;
+  s_cursor = 0;
+  s_burstMs = 0;
+  store_cursor(0);
+}
+
+bool sd_journal_begin() {
+  s_ready = false;
+  if (SD.cardType() == CARD_NONE) return false;
+  Preferences p;
+  if (p.begin(JRNL_NVS_NS, true)) {
+    s_stored = p.getUInt(JRNL_NVS_KEY, 0);
+    p.end();
+  }
+  s_cursor = s_stored;
+  s_size = 0;
+  File f = SD.open(JOURNAL_PATH, FILE_READ);
+  if (f) {
+    s_size = f.size();
+    f.close();
+  }
+  s_ready = true;
+  // 文件被删/换卡：游标作废
+  if (s_cursor >= s_size) reset_file();
+  if (s_size) {
+    log2Val("[JRNL] Pending bytes: ", (int)(s_size - s_cursor));
+  }
+  return true;
+}
+
+bool sd_journal_append(uint8_t type, const uint8_t* data, uint16_t len) {
+  if (!s_ready || len > JRNL_DATA_MAX || (len && !data)) {
+    s_st.append_fail++;
+    return false;
+  }
+  uint16_t total = JRNL_HDR_LEN + len + 2;
+  if (s_size + total > JOURNAL_MAX_BYTES) {
+    s_st.dropped_full++;
+    return false;
+  }
+  uint8_t rec[JRNL_REC_MAX];
+  rec[0] = JRNL_MAGIC;
+  rec[1] = type;
+  rec[2] = (uint8_t)(len & 0xFF);
+  rec[3] = (uint8_t)(len >> 8);
+  if (len) memcpy(rec + JRNL_HDR_LEN, data, len);
+  uint16_t crc = crc16_modbus(rec + 1, JRNL_HDR_LEN - 1 + len);
+  rec[JRNL_HDR_LEN + len] = (uint8_t)(crc & 0xFF);
+  rec[JRNL_HDR_LEN + len + 1] = (uint8_t)(crc >> 8);
+
+  File f = SD.open(JOURNAL_PATH, FILE_APPEND);
+  if (!f) {
+    s_st.append_fail++;
+    return false;
+  }
+  size_t w = f.write(rec, total);
+  f.close();
+  // 写了一半的记录留在文件里，读取时按校验失败跳过
+  s_size += w;
+  if (w != total) {
+    s_st.append_fail++;
+    return false;
+  }
+  s_st.appended++;
+  return true;
+}
+
+bool sd_journal_pending() {
+  return s_ready && s_cursor < s_size;
+}
+
+bool sd_journal_peek(uint8_t* type, uint8_t* buf, uint16_t* len) {
+  s_peekLen = 0;
+  while (sd_journal_pending()) {
+    File f = SD.open(JOURNAL_PATH, FILE_READ);
+    if (!f) return false;
+    uint8_t rec[JRNL_REC_MAX];
+    uint32_t avail = s_size - s_cursor;
+    size_t n = 0;
+    if (f.seek(s_cursor)) n = f.read(rec, avail < sizeof(rec) ? avail : sizeof(rec));
+    f.close();
+    if (n == 0) return false;
+
+    if (n >= JRNL_HDR_LEN && rec[0] == JRNL_MAGIC) {
+      uint16_t l = (uint16_t)rec[2] | ((uint16_t)rec[3] << 8);
+      if (l <= JRNL_DATA_MAX && (size_t)JRNL_HDR_LEN + l + 2 <= n) {
+        uint16_t crc = (uint16_t)rec[JRNL_HDR_LEN + l] | ((uint16_t)rec[JRNL_HDR_LEN + l + 1] << 8);
+        if (crc == crc16_modbus(rec + 1, JRNL_HDR_LEN - 1 + l)) {
+          *type = rec[1];
+          *len = l;
+          memcpy(buf, rec + JRNL_HDR_LEN, l);
+          s_peekLen = JRNL_HDR_LEN + l + 2;
+          return true;
+        }
+      }
+    }
+    // 损坏或不完整：跳到下一个 magic
+    s_st.corrupt++;
+    size_t skip = 1;
+    while (skip < n && rec[skip] != JRNL_MAGIC) ++skip;
+    s_cursor += skip;
+  }
+  if (s_ready && s_size) reset_file();
+  return false;
+}
+
+void sd_journal_consume() {
+  if (!s_peekLen) return;
+  uint32_t now = millis();
+  if (!s_burstMs) {
+    s_burstMs = now;
+    s_burstBytes = 0;
+  }
+  s_cursor += s_peekLen;
+  s_burstBytes += s_peekLen;
+  s_st.replayed++;
+  s_st.replayed_bytes += s_peekLen;
+  if (now - s_burstMs > 0) s_st.replay_bps = (uint32_t)((uint64_t)s_burstBytes * 1000 / (now - s_burstMs));
+  s_peekLen = 0;
+  if (s_cursor >= s_size) reset_file();
+}
+
+void sd_journal_commit() {
+  if (s_ready) store_cursor(s_cursor);
+}
+
+void sd_journal_get_stats(JournalStats& out) {
+  out = s_st;
+  out.file_bytes = s_size;
+  out.pending_bytes = s_size - s_cursor;
+}
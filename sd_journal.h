@@ -0,0 +1,48 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+
+// 离线日志：断链期间要上行的消息（实时数据、事件）顺序追加到SD上的单个文件，重连后从游标处按序补传
+// 记录格式：magic(1) type(1) len(2) data(len) crc16(2)，每条一次写入并关闭文件；
+// 掉电写了一半的记录CRC不符，读取时跳过并向后重新找 magic，其后追加的记录不受影响
+// 游标（已补传到的偏移）存 NVS，按批落盘；全部补传完后删除文件。掉电可能重复补传最后一批，不会丢失
+// 只在主循环中调用
+
+enum JournalRecType : uint8_t {
+  JRNL_PACKET = 1,   // 小包：cmd(2, 大端) + payload
+  JRNL_EVENT  = 2,   // 事件：时间(7) + 触发条件(1) + 图片路径（可为空）
+};
+
+#define JRNL_DATA_MAX  (DTU_TX_INLINE_MAX + 2)
+
+struct JournalStats {
+  uint32_t appended = 0;
+  uint32_t append_fail = 0;   // SD不可用或写入失败
+  uint32_t dropped_full = 0;  // 超过 JOURNAL_MAX_BYTES 被丢弃
+  uint32_t replayed = 0;      // 已补传（消费）的记录
+  uint32_t replayed_bytes = 0;
+  uint32_t corrupt = 0;       // 校验失败、跳过重新同步的次数
+  uint32_t file_bytes = 0;    // 文件当前大小
+  uint32_t pending_bytes = 0; // 未补传的字节
+  uint32_t replay_bps = 0;    // 最近一次补传期间的平均速率（记录字节/秒）
+};
+
+// SD 挂载后调用：读取游标，文件不存在或游标越界时复位
+bool sd_journal_begin();
+
+// 追加一条记录；SD不可用、写失败或超出容量返回 false
+bool sd_journal_append(uint8_t type, const uint8_t* data, uint16_t len);
+
+// 是否有未补传的记录
+bool sd_journal_pending();
+
+// 读取游标处的记录（不前移），buf 至少 JRNL_DATA_MAX 字节；无记录返回 false
+bool sd_journal_peek(uint8_t* type, uint8_t* buf, uint16_t* len);
+
+// 游标越过 peek 到的记录（仅内存）；全部补传完时删除文件
+void sd_journal_consume();
+
+// 游标写入 NVS（一批结束时调用，避免每条记录写一次 flash）
+void sd_journal_commit();
+
+void sd_journal_get_stats(JournalStats& out);
@@ -2,6 +2,7 @@
 #include "config.h"
 #include "sd_async.h"
 #include "rtc_soft.h"
+#include "photo_sidecar.h"
 
 SPIClass sdSPI(VSPI);
 
@@ -32,6 +33,22 @@ static void make_photo_name(char* out, size_t outSize) {
     s_photo_counter++;
 }
 
+// 同步写卡（异步不可用或入队失败时的回退路径），成功后生成CRC旁路记录
+static bool write_photo_sync(const char* name, const uint8_t* data, size_t len) {
+    File f = SD.open(name, FILE_WRITE);
+    if (!f) return false;
+    size_t w = f.write(data, len);
+    f.close();
+    if (w != len) return false;
+#if PHOTO_SIDECAR_ENABLE
+    PhotoDigest dg;
+    photo_digest_init(&dg);
+    photo_digest_update(&dg, data, len);
+    photo_sidecar_write(name, &dg);
+#endif
+    return true;
+}
+
 bool save_frame_to_sd(camera_fb_t *fb, uint32_t index) {
     if (!fb) return false;
     // 忽略传入index，使用自带唯一命名
@@ -55,11 +72,7 @@ bool save_frame_to_sd_raw(const uint8_t* data, size_t len, uint32_t index) {
         // 队列满或内存不足，继续走同步写
     }
 
-    File f = SD.open(name, FILE_WRITE);
-    if (!f) return false;
-    size_t w = f.write(data, len);
-    f.close();
-    return w == len;
+    return write_photo_sync(name, data, len);
 }
 
 // 新增：保存并返回实际文件名（时间命名）
@@ -76,20 +89,10 @@ bool save_frame_to_sd_with_name(camera_fb_t* fb, char* outFile, size_t outFileSi
         ok = sd_async_submit(name, fb->buf, fb->len);
         if (!ok) {
             // 回退同步写
-            File f = SD.open(name, FILE_WRITE);
-            if (f) {
-                size_t w = f.write(fb->buf, fb->len);
-                f.close();
-                ok = (w == fb->len);
-            }
+            ok = write_photo_sync(name, fb->buf, fb->len);
         }
     } else {
-        File f = SD.open(name, FILE_WRITE);
-        if (f) {
-            size_t w = f.write(fb->buf, fb->len);
-            f.close();
-            ok = (w == fb->len);
-        }
+        ok = write_photo_sync(name, fb->buf, fb->len);
     }
 
     if (ok) {
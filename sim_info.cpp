@@ -1,7 +1,7 @@
 #include "sim_info.h"
 #include "uart_utils.h"
+#include "at_engine.h"
 #include <Arduino.h>
-#include <ctype.h>
 #include <string.h>
 
 #define SIM_DBG 1
@@ -15,101 +15,72 @@
 #define SIM_LOGVAL(k, v)
 #endif
 
-static bool waitForATResponse(const char* at, char* out, size_t outlen, const char* prefix, uint32_t timeout = 2000) {
-    out[0] = 0;
-    SIM_LOG2("[SIM] Send AT: ", at);
-    sendCmd(at);
-    uint32_t start = millis();
-    while (millis() - start < timeout) {
-        while (Serial.available()) {
-            String line = Serial.readStringUntil('\n');
-            line.trim();
-            if (line.length() == 0) continue;
-            SIM_LOG2("[SIM] AT Resp: ", line.c_str());
-            if (prefix && !line.startsWith(prefix)) continue;
-            strncpy(out, line.c_str(), outlen - 1);
-            out[outlen - 1] = 0;
-            return true;
-        }
-        delay(10);
-    }
-    SIM_LOG("[SIM] AT timeout");
-    return false;
-}
+static const uint32_t SIM_AT_TIMEOUT_MS = 2000;
 
-static bool collectIMSI(char* out, size_t outlen, uint32_t timeout = 2000) {
-    out[0] = 0;
-    SIM_LOG2("[SIM] Send AT: ", "AT+CIMI");
-    sendCmd("AT+CIMI");
-    uint32_t start = millis();
-    bool found = false;
-    while (millis() - start < timeout) {
-        while (Serial.available()) {
-            String line = Serial.readStringUntil('\n');
-            line.trim();
-            if (line.length() == 0) continue;
-            SIM_LOG2("[SIM] AT Resp: ", line.c_str());
-            if (line == "OK" || !isdigit(line[0])) continue;
-            if (line.length() >= 10 && line.length() <= 16) {
-                strncpy(out, line.c_str(), outlen - 1);
-                out[outlen - 1] = 0;
-                found = true;
-                break;
-            }
-        }
-        if (found) break;
-        delay(10);
-    }
-    if (!found) SIM_LOG("[SIM] IMSI not found");
-    return found;
-}
+static SimInfo       s_sim;
+static bool          s_running = false;
+static SimInfoDoneFn s_done = nullptr;
+static void*         s_ctx = nullptr;
 
-bool siminfo_query(SimInfo* sim) {
-    memset(sim, 0, sizeof(SimInfo));
+static void finishQuery() {
+    s_sim.valid = s_sim.iccid_len > 0 && s_sim.imsi_len > 0;
+    if (s_sim.valid) SIM_LOG("[SIM] SIM info collect OK");
+    else SIM_LOG("[SIM] SIM info invalid");
+    s_running = false;
+    if (s_done) s_done(&s_sim, s_ctx);
+}
 
-    char buf[64];
-    if (waitForATResponse("AT+MCCID", buf, sizeof(buf), "+MCCID:")) {
-        char* p = strchr(buf, ':');
-        if (p) {
-            ++p;
-            while (*p == ' ') ++p;
-            strncpy(sim->iccid, p, 20);
-            sim->iccid[20] = 0;
-            sim->iccid_len = strlen(sim->iccid);
-            SIM_LOG2("[SIM] ICCID: ", sim->iccid);
-        } else {
-            SIM_LOG("[SIM] ICCID line malformed");
-        }
+static void onCsq(AtResult res, const AtLine* info, void*) {
+    // +CSQ: rssi,ber
+    int32_t rssi = info ? at_field_int(*info, 0) : -1;
+    if (res == AT_RES_OK && info) {
+        if (rssi >= 0 && rssi <= 31) s_sim.signal = (uint8_t)(rssi * 100 / 31);
+        else s_sim.signal = 0;
+        SIM_LOGVAL("[SIM] Signal(0-100): ", s_sim.signal);
     } else {
-        SIM_LOG("[SIM] ICCID read fail");
+        SIM_LOG("[SIM] Signal read fail");
     }
+    finishQuery();
+}
 
-    if (collectIMSI(buf, sizeof(buf))) {
-        strncpy(sim->imsi, buf, 15);
-        sim->imsi[15] = 0;
-        sim->imsi_len = strlen(sim->imsi);
-        SIM_LOG2("[SIM] IMSI: ", sim->imsi);
+static void onCimi(AtResult res, const AtLine* info, void*) {
+    // IMSI 为无前缀的纯数字行
+    if (res == AT_RES_OK && info && info->len >= 10 && info->len <= 16) {
+        size_t n = info->len > 15 ? 15 : info->len;
+        memcpy(s_sim.imsi, info->text, n);
+        s_sim.imsi[n] = 0;
+        s_sim.imsi_len = (uint8_t)n;
+        SIM_LOG2("[SIM] IMSI: ", s_sim.imsi);
     } else {
         SIM_LOG("[SIM] IMSI read fail");
     }
+    if (!at_submit("AT+CSQ", "+CSQ", SIM_AT_TIMEOUT_MS, onCsq)) finishQuery();
+}
 
-    if (waitForATResponse("AT+CSQ", buf, sizeof(buf), "+CSQ:")) {
-        int rssi = 0;
-        char* p = strchr(buf, ':');
-        if (p) {
-            ++p;
-            while (*p == ' ') ++p;
-            rssi = atoi(p);
-            if (rssi >= 0 && rssi <= 31) sim->signal = (uint8_t)(rssi * 100 / 31);
-            else sim->signal = 0;
-            SIM_LOGVAL("[SIM] Signal(0-100): ", sim->signal);
-        }
+static void onMccid(AtResult res, const AtLine* info, void*) {
+    // +MCCID: <iccid>
+    if (res == AT_RES_OK && info && info->nfield > 0) {
+        const AtField& f = info->field[0];
+        size_t n = f.len > 20 ? 20 : f.len;
+        memcpy(s_sim.iccid, f.s, n);
+        s_sim.iccid[n] = 0;
+        s_sim.iccid_len = (uint8_t)n;
+        SIM_LOG2("[SIM] ICCID: ", s_sim.iccid);
     } else {
-        SIM_LOG("[SIM] Signal read fail");
+        SIM_LOG("[SIM] ICCID read fail");
     }
+    if (!at_submit("AT+CIMI", nullptr, SIM_AT_TIMEOUT_MS, onCimi, nullptr, AT_F_INFO_DIGITS)) {
+        finishQuery();
+    }
+}
 
-    sim->valid = sim->iccid_len > 0 && sim->imsi_len > 0;
-    if (sim->valid) SIM_LOG("[SIM] SIM info collect OK");
-    else SIM_LOG("[SIM] SIM info invalid");
-    return sim->valid;
-}
\ No newline at end of file
+bool siminfo_query_async(SimInfoDoneFn done, void* ctx) {
+    if (s_running) return false;
+    memset(&s_sim, 0, sizeof(s_sim));
+    s_done = done;
+    s_ctx = ctx;
+    SIM_LOG("[SIM] Query start");
+    if (!at_submit("AT+MCCID", "+MCCID", SIM_AT_TIMEOUT_MS, onMccid)) return false;
+    s_running = true;
+    return true;
+}
@@ -12,5 +12,9 @@ typedef struct {
     bool valid;        // 是否采集成功
 } SimInfo;
 
-// 同步采集SIM卡信息（阻塞等待AT应答）
-bool siminfo_query(SimInfo* out);
+// 采集完成回调：sim 仅在回调内有效，sim->valid 表示是否采集成功
+typedef void (*SimInfoDoneFn)(const SimInfo* sim, void* ctx);
+
+// 异步采集SIM卡信息：MCCID -> CIMI -> CSQ 经AT引擎依次发送，不阻塞主循环
+// 已有采集在进行或命令队列满时返回 false
+bool siminfo_query_async(SimInfoDoneFn done, void* ctx = nullptr);
@@ -0,0 +1,190 @@
+// at_parser 主机测试：录制的模组应答/URC 逐行分类与字段提取；
+// 加 --bench 参数时测每秒处理行数，并与旧的 String + trim + strstr 链对比
+#include "at_parser.h"
+#include <chrono>
+#include <string>
+
+uint32_t millis() { return 0; }
+uint32_t micros() { return 0; }
+void delay(uint32_t) {}
+size_t HardwareSerial::write(const uint8_t*, size_t len) { return len; }
+HardwareSerial Serial;
+
+static int s_fail = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); s_fail++; } \
+  } while (0)
+
+// 一次开机建链、查询 SIM 信息、发包、断链重连的串口记录（含回显与行尾空白）
+static const char* const TRAFFIC[] = {
+  "+MATREADY\r\n",
+  "AT\r\n",
+  "OK\r\n",
+  "AT+CEREG?\r\n",
+  "+CEREG: 0,1\r\n",
+  "OK\r\n",
+  "OK\r\n",
+  "+MIPCLOSE: 0\r\n",
+  "ERROR\r\n",
+  "OK\r\n",
+  "+MIPOPEN: 0,0\r\n",
+  "+CSQ: 23,99\r\n",
+  "OK\r\n",
+  "460041234567890\r\n",
+  "OK\r\n",
+  "+MCCID: 89860412345678901234\r\n",
+  "OK\r\n",
+  "+MIPSEND: 0,128\r\n",
+  "OK\r\n",
+  "+MIPSEND: 0,128\r\n",
+  "OK\r\n",
+  "+MIPSTATE: 0,\"TCP\",\"47.104.5.75\",9909,\"CONNECTED\"\r\n",
+  "OK\r\n",
+  "+MIPURC: \"rtcp\",0,21\r\n",
+  "+CME ERROR: 50\r\n",
+  "+MIPURC: \"disconn\",0,1\r\n",
+  "+MIPSTATE: 0,\"TCP\",\"47.104.5.75\",9909,\"DISCONNECTED\"\r\n",
+  "  OK  \r\n",
+  "+MIPOPEN: 0,566\r\n",
+};
+static const size_t TRAFFIC_N = sizeof(TRAFFIC) / sizeof(TRAFFIC[0]);
+
+static AtLineKind kind_of(const char* s) {
+  AtLine l;
+  at_parse_line(s, &l);
+  return l.kind;
+}
+
+static void test_classify() {
+  CHECK(kind_of("OK") == AT_LINE_OK);
+  CHECK(kind_of("  OK  \r\n") == AT_LINE_OK);
+  CHECK(kind_of("ERROR") == AT_LINE_ERROR);
+  CHECK(kind_of("+CME ERROR: 50") == AT_LINE_ERROR);
+  CHECK(kind_of("+CMS ERROR: 500") == AT_LINE_ERROR);
+  CHECK(kind_of("+MATREADY") == AT_LINE_MATREADY);
+  CHECK(kind_of("+CEREG: 0,1") == AT_LINE_CEREG);
+  CHECK(kind_of("+CSQ: 23,99") == AT_LINE_CSQ);
+  CHECK(kind_of("+MCCID: 8986") == AT_LINE_MCCID);
+  CHECK(kind_of("+MIPOPEN: 0,0") == AT_LINE_MIPOPEN);
+  CHECK(kind_of("+MIPCLOSE: 0") == AT_LINE_MIPCLOSE);
+  CHECK(kind_of("+MIPSTATE: 0") == AT_LINE_MIPSTATE);
+  CHECK(kind_of("+MIPSEND: 0,128") == AT_LINE_MIPSEND);
+  CHECK(kind_of("+MIPURC: \"disconn\",0,1") == AT_LINE_MIPURC);
+  // 回显、纯数字行、相近前缀均不误判
+  CHECK(kind_of("AT+CEREG?") == AT_LINE_OTHER);
+  CHECK(kind_of("460041234567890") == AT_LINE_OTHER);
+  CHECK(kind_of("OKAY") == AT_LINE_OTHER);
+  CHECK(kind_of("+MIPSENDX: 0") == AT_LINE_OTHER);
+  CHECK(kind_of("+MIP") == AT_LINE_OTHER);
+  CHECK(kind_of("+") == AT_LINE_OTHER);
+  AtLine l;
+  CHECK(!at_parse_line("\r\n", &l));
+  CHECK(!at_parse_line("", &l));
+}
+
+static void test_fields() {
+  AtLine l;
+  CHECK(at_parse_line("+CEREG: 0,5", &l));
+  CHECK(l.nfield == 2);
+  CHECK(at_field_int(l, 1) == 5);
+  CHECK(at_field_int(l, 2, -7) == -7);
+
+  CHECK(at_parse_line("+MIPSTATE: 0,\"TCP\",\"47.104.5.75\",9909,\"DISCONNECTED\"", &l));
+  CHECK(l.nfield == 5);
+  CHECK(at_field_is(l, 1, "TCP"));
+  CHECK(at_field_is(l, 2, "47.104.5.75"));   // 引号内的点号与数字不当作数值
+  CHECK(at_field_int(l, 2) == -1);
+  CHECK(at_field_int(l, 3) == 9909);
+  CHECK(at_field_is(l, 4, "DISCONNECTED"));
+  CHECK(!at_field_is(l, 4, "CONNECTED"));
+
+  CHECK(at_parse_line("+MIPURC: \"disconn\",0,1", &l));
+  CHECK(at_field_is(l, 0, "disconn"));
+  CHECK(at_field_int(l, 2) == 1);
+
+  // 逗号在引号内不拆分；负数；超长数字串只作文本
+  CHECK(at_parse_line("+MIPURC: \"a,b\",-3", &l));
+  CHECK(l.nfield == 2);
+  CHECK(at_field_is(l, 0, "a,b"));
+  CHECK(at_field_int(l, 1) == -3);
+  CHECK(at_parse_line("+MCCID: 89860412345678901234", &l));
+  CHECK(at_field_int(l, 0) == -1);
+  CHECK(l.field[0].len == 20);
+
+  CHECK(at_parse_line("+CSQ: 23 , 99 ", &l));
+  CHECK(at_field_int(l, 0) == 23);
+  CHECK(at_field_int(l, 1) == 99);
+}
+
+// 整段记录：每行都能分类，数量与记录一致
+static void test_traffic() {
+  size_t n[AT_LINE_MIPURC + 1] = {0};
+  for (size_t i = 0; i < TRAFFIC_N; ++i) {
+    AtLine l;
+    CHECK(at_parse_line(TRAFFIC[i], &l));
+    n[l.kind]++;
+  }
+  CHECK(n[AT_LINE_OK] == 11);
+  CHECK(n[AT_LINE_ERROR] == 2);
+  CHECK(n[AT_LINE_MIPSEND] == 2);
+  CHECK(n[AT_LINE_MIPURC] == 2);
+  CHECK(n[AT_LINE_MIPOPEN] == 2);
+  CHECK(n[AT_LINE_OTHER] == 3);   // 两行回显 + IMSI
+}
+
+// ---- 旧路径：每行复制成字符串、trim，再依次 strstr ----
+static int old_classify(const char* raw) {
+  std::string s(raw);
+  size_t b = s.find_first_not_of(" \t\r\n");
+  if (b == std::string::npos) return -1;
+  s = s.substr(b, s.find_last_not_of(" \t\r\n") - b + 1);
+  const char* c = s.c_str();
+  if (strstr(c, "+MIPURC")) return AT_LINE_MIPURC;
+  if (strstr(c, "+MIPOPEN")) return AT_LINE_MIPOPEN;
+  if (strstr(c, "+MIPSTATE")) return AT_LINE_MIPSTATE;
+  if (strstr(c, "+MIPCLOSE")) return AT_LINE_MIPCLOSE;
+  if (strstr(c, "+MIPSEND")) return AT_LINE_MIPSEND;
+  if (strstr(c, "+CEREG")) return AT_LINE_CEREG;
+  if (strstr(c, "+CSQ")) return AT_LINE_CSQ;
+  if (strstr(c, "+MCCID")) return AT_LINE_MCCID;
+  if (strstr(c, "+MATREADY")) return AT_LINE_MATREADY;
+  if (strstr(c, "ERROR")) return AT_LINE_ERROR;
+  if (strstr(c, "OK")) return AT_LINE_OK;
+  return AT_LINE_OTHER;
+}
+
+static void bench() {
+  const int reps = 200000;
+  volatile int sink = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int r = 0; r < reps; ++r) {
+    for (size_t i = 0; i < TRAFFIC_N; ++i) {
+      AtLine l;
+      at_parse_line(TRAFFIC[i], &l);
+      sink = sink + l.kind + l.nfield;
+    }
+  }
+  double sNew = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  t0 = std::chrono::steady_clock::now();
+  for (int r = 0; r < reps; ++r) {
+    for (size_t i = 0; i < TRAFFIC_N; ++i) sink = sink + old_classify(TRAFFIC[i]);
+  }
+  double sOld = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  double lines = (double)reps * TRAFFIC_N;
+  printf("at_parse_line (with fields): %.1f M lines/s | String+strstr (kind only): %.1f M lines/s\n",
+         lines / sNew / 1e6, lines / sOld / 1e6);
+}
+
+int main(int argc, char** argv) {
+  test_classify();
+  test_fields();
+  test_traffic();
+  if (s_fail) {
+    printf("at_parser_test: %d failure(s)\n", s_fail);
+    return 1;
+  }
+  printf("at_parser_test: OK\n");
+  if (argc > 1 && strcmp(argv[1], "--bench") == 0) bench();
+  return 0;
+}
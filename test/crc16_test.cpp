@@ -0,0 +1,132 @@
+// crc16 主机测试：Modbus 标准向量、与逐位参考实现对比、流式分块、crc16_combine 拼接；
+// 加 --bench 参数时测吞吐（按 CRC16_IMPL 分别编译，见 Makefile）
+#include "crc16.h"
+#include <chrono>
+#include <vector>
+
+uint32_t millis() { return 0; }
+uint32_t micros() { return 0; }
+void delay(uint32_t) {}
+size_t HardwareSerial::write(const uint8_t*, size_t len) { return len; }
+HardwareSerial Serial;
+
+static int s_fail = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); s_fail++; } \
+  } while (0)
+
+static uint16_t ref_crc(const uint8_t* d, size_t n) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < n; ++i) {
+    crc ^= d[i];
+    for (int j = 0; j < 8; ++j) crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+  }
+  return crc;
+}
+
+static uint32_t s_rng = 12345;
+static uint8_t rnd8() {
+  s_rng = s_rng * 1103515245u + 12345u;
+  return (uint8_t)(s_rng >> 16);
+}
+
+static void test_vectors() {
+  CHECK(crc16_modbus((const uint8_t*)"123456789", 9) == 0x4B37);
+  CHECK(crc16_modbus(nullptr, 0) == 0xFFFF);
+  // 读保持寄存器请求帧，CRC 低字节在前：84 0A / C5 CD
+  const uint8_t req1[] = {0x01, 0x03, 0x00, 0x00, 0x00, 0x01};
+  const uint8_t req2[] = {0x01, 0x03, 0x00, 0x00, 0x00, 0x0A};
+  CHECK(crc16_modbus(req1, sizeof(req1)) == 0x0A84);
+  CHECK(crc16_modbus(req2, sizeof(req2)) == 0xCDC5);
+}
+
+// 各长度、各起始对齐下与逐位实现一致（覆盖切片主循环与尾部）
+static void test_against_reference() {
+  std::vector<uint8_t> buf(1100);
+  for (auto& b : buf) b = rnd8();
+  for (size_t off = 0; off < 8; ++off) {
+    for (size_t n = 0; n <= 1024; n += (n < 40 ? 1 : 37)) {
+      CHECK(crc16_modbus(buf.data() + off, n) == ref_crc(buf.data() + off, n));
+    }
+  }
+}
+
+static void test_streaming() {
+  std::vector<uint8_t> buf(5000);
+  for (auto& b : buf) b = rnd8();
+  uint16_t whole = crc16_modbus(buf.data(), buf.size());
+  for (int round = 0; round < 50; ++round) {
+    Crc16Ctx c;
+    crc16_init(&c);
+    size_t pos = 0;
+    while (pos < buf.size()) {
+      size_t k = 1 + rnd8() % 97;
+      if (k > buf.size() - pos) k = buf.size() - pos;
+      crc16_update(&c, buf.data() + pos, k);
+      pos += k;
+    }
+    crc16_update(&c, nullptr, 0);   // 空块不改变结果
+    CHECK(crc16_final(&c) == whole);
+  }
+}
+
+// crc(A||B) 由两段 CRC 拼出，任意切分点都与整段计算一致
+static void test_combine() {
+  std::vector<uint8_t> buf(70000);
+  for (auto& b : buf) b = rnd8();
+  const size_t lens[] = {0, 1, 2, 9, 128, 1000, 65000, 70000};
+  for (size_t n : lens) {
+    uint16_t whole = crc16_modbus(buf.data(), n);
+    const size_t cuts[] = {0, 1, n / 3, n / 2, n > 0 ? n - 1 : 0, n};
+    for (size_t cut : cuts) {
+      if (cut > n) continue;
+      uint16_t a = crc16_modbus(buf.data(), cut);
+      uint16_t b = crc16_modbus(buf.data() + cut, n - cut);
+      CHECK(crc16_combine(a, b, (uint32_t)(n - cut)) == whole);
+    }
+  }
+  // 三段拼接（图片 + 元数据 + 尾部）
+  uint16_t a = crc16_modbus(buf.data(), 60000);
+  uint16_t b = crc16_modbus(buf.data() + 60000, 21);
+  uint16_t c = crc16_modbus(buf.data() + 60021, 7);
+  uint16_t ab = crc16_combine(a, b, 21);
+  CHECK(crc16_combine(ab, c, 7) == crc16_modbus(buf.data(), 60028));
+}
+
+static double mb_per_s(uint16_t (*fn)(const uint8_t*, size_t), const std::vector<uint8_t>& buf, int reps) {
+  volatile uint16_t sink = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < reps; ++i) sink = sink ^ fn(buf.data(), buf.size());
+  double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  return (double)buf.size() * reps / s / 1e6;
+}
+
+static void bench() {
+  std::vector<uint8_t> buf(64 * 1024);
+  for (auto& b : buf) b = rnd8();
+  double ref = mb_per_s(ref_crc, buf, 200);
+  double impl = mb_per_s(crc16_modbus, buf, 2000);
+  uint16_t a = crc16_modbus(buf.data(), 60000);
+  uint16_t b = crc16_modbus(buf.data() + 60000, 1000);
+  auto t0 = std::chrono::steady_clock::now();
+  volatile uint16_t sink = 0;
+  for (int i = 0; i < 100000; ++i) sink = sink ^ crc16_combine(a, b, 1000 + (i & 7));
+  double us = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count() * 1e6 / 100000;
+  printf("CRC16_IMPL=%d  bitwise %.1f MB/s  impl %.1f MB/s (x%.1f)  combine %.2f us\n",
+         CRC16_IMPL, ref, impl, impl / ref, us);
+}
+
+int main(int argc, char** argv) {
+  test_vectors();
+  test_against_reference();
+  test_streaming();
+  test_combine();
+  if (s_fail) {
+    printf("crc16_test (CRC16_IMPL=%d): %d failure(s)\n", CRC16_IMPL, s_fail);
+    return 1;
+  }
+  printf("crc16_test (CRC16_IMPL=%d): OK\n", CRC16_IMPL);
+  if (argc > 1 && strcmp(argv[1], "--bench") == 0) bench();
+  return 0;
+}
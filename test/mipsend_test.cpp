@@ -0,0 +1,394 @@
+// mipsend 主机测试：模拟模组逐行应答（经 at_parse_line 解析后喂给 mipsend_on_line），
+// 检查 HEX 整行组装、发送窗口、ERROR 后的 go-back-N 重传顺序、流空洞/超时判定、提示符模式停等
+// 与按上传累计的统计；
+// 加 --bench 参数时对比逐字节写出的旧路径
+#include "mipsend.h"
+#include "config.h"
+#include "uart_utils.h"
+#include "at_engine.h"
+#include <chrono>
+#include <string>
+#include <vector>
+
+static int s_fail = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); s_fail++; } \
+  } while (0)
+
+// ---- 时钟：delay 推进假时间，等待应答超时可在测试中复现 ----
+static uint32_t s_now = 0;
+uint32_t millis() { return s_now; }
+uint32_t micros() { return s_now * 1000; }
+void delay(uint32_t ms) { s_now += ms; }
+
+// ---- 模拟模组 ----
+// 每收到一整行 AT+MIPSEND=0,0,<HEX>（或提示符模式下一整块原始字节）记为一次发送；
+// readDTU 每次按发送顺序应答最早一行
+struct MockModem {
+  std::string wire;                        // 未成行的串口输出
+  std::vector<std::vector<uint8_t>> sent;  // 每行解码后的数据
+  std::vector<int> writesPerLine;
+  int writesInLine = 0;
+  size_t answered = 0;
+  size_t maxOutstanding = 0;
+  std::vector<uint8_t> stream;             // 模组接受（OK）的字节，即 TCP 流
+  bool (*accept)(size_t idx) = nullptr;    // 第 idx 行的应答，nullptr=全部 OK
+  bool silent = false;                     // 不应答（测超时）
+  bool benchSink = false;                  // 吞吐测试：只计数，每行直接应答 OK
+  size_t benchBytes = 0;
+  size_t benchCalls = 0;
+  size_t binLeft = 0;                      // 提示符模式：本块还要收的原始字节
+  std::vector<uint8_t> binBlock;
+  size_t cmdWhileBusy = 0;                 // 提示符模式：上一块未应答时又发出的命令数
+};
+static MockModem m;
+
+static void mock_reset() {
+  m = MockModem();
+}
+
+static int hexval(char c) {
+  return c <= '9' ? c - '0' : c - 'A' + 10;
+}
+
+static void on_block(const std::vector<uint8_t>& d) {
+  m.sent.push_back(d);
+  m.writesPerLine.push_back(m.writesInLine);
+  size_t out = m.sent.size() - m.answered;
+  if (out > m.maxOutstanding) m.maxOutstanding = out;
+}
+
+static void on_wire_line(const std::string& line) {
+  static const std::string pfx = "AT+MIPSEND=0,0,";
+  if (line.compare(0, pfx.size(), pfx) != 0) return;
+  std::vector<uint8_t> d;
+  for (size_t i = pfx.size(); i + 1 < line.size(); i += 2) {
+    d.push_back((uint8_t)(hexval(line[i]) << 4 | hexval(line[i + 1])));
+  }
+  on_block(d);
+}
+
+size_t HardwareSerial::write(const uint8_t* data, size_t len) {
+  if (m.benchSink) {
+    m.benchBytes += len;
+    m.benchCalls++;
+    if (len && data[len - 1] == '\n') m.sent.emplace_back();
+    return len;
+  }
+  m.writesInLine++;
+  if (m.binLeft) {
+    size_t k = len < m.binLeft ? len : m.binLeft;
+    m.binBlock.insert(m.binBlock.end(), data, data + k);
+    m.binLeft -= k;
+    if (!m.binLeft) {
+      on_block(m.binBlock);
+      m.writesInLine = 0;
+    }
+    return len;
+  }
+  m.wire.append((const char*)data, len);
+  size_t nl;
+  while ((nl = m.wire.find("\r\n")) != std::string::npos) {
+    on_wire_line(m.wire.substr(0, nl));
+    m.wire.erase(0, nl + 2);
+    m.writesInLine = 0;
+  }
+  return len;
+}
+HardwareSerial Serial;
+
+static void feed(const char* text) {
+  AtLine l;
+  if (at_parse_line(text, &l)) mipsend_on_line(l);
+}
+
+void readDTU() {
+  if (m.silent || m.answered >= m.sent.size()) return;
+  size_t idx = m.answered++;
+  bool ok = m.accept ? m.accept(idx) : true;
+  if (m.benchSink) {
+    feed("OK");
+    return;
+  }
+  if (ok) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "+MIPSEND: 0,%u", (unsigned)m.sent[idx].size());
+    feed(buf);
+    feed("OK");
+    m.stream.insert(m.stream.end(), m.sent[idx].begin(), m.sent[idx].end());
+  } else {
+    feed("ERROR");
+  }
+}
+
+// 提示符模式：AT+MIPSEND=0,<len> 后立即给出 '>'，随后的 len 字节为一块
+bool dtu_wait_prompt(char, uint32_t) { return m.binLeft > 0; }
+void sendCmd(const char* cmd) {
+  unsigned n = 0;
+  if (sscanf(cmd, "AT+MIPSEND=0,%u", &n) != 1 || n == 0) return;
+  if (m.sent.size() > m.answered) m.cmdWhileBusy++;
+  m.binLeft = n;
+  m.binBlock.clear();
+}
+void at_engine_wait_idle() {}
+
+// ---- 工具 ----
+static std::vector<uint8_t> make_data(size_t n, uint32_t seed) {
+  std::vector<uint8_t> d(n);
+  for (auto& b : d) {
+    seed = seed * 1103515245u + 12345u;
+    b = (uint8_t)(seed >> 16);
+  }
+  return d;
+}
+
+// 按不规则的小段写入一个包（模拟头、元数据、图片块交替写入）
+static bool send_packet(const std::vector<uint8_t>& d) {
+  mipsend_begin();
+  size_t pos = 0, step = 7;
+  while (pos < d.size()) {
+    size_t k = d.size() - pos < step ? d.size() - pos : step;
+    mipsend_write(d.data() + pos, k);
+    pos += k;
+    step = step * 3 % 211 + 1;
+  }
+  return mipsend_end();
+}
+
+static void fresh() {
+  mock_reset();
+  mipsend_set_mode(MIPSEND_MODE_HEX);   // 窗口、块长回到初值
+  (void)mipsend_take_stream_error();
+}
+
+// ---- 用例 ----
+// 每行一次写出，前缀与 HEX 正确，各行拼起来即原数据
+static void test_line_format() {
+  fresh();
+  auto d = make_data(300, 1);
+  CHECK(send_packet(d));
+  CHECK(m.sent.size() == 3);
+  std::vector<uint8_t> all;
+  for (size_t i = 0; i < m.sent.size(); ++i) {
+    CHECK(m.writesPerLine[i] == 1);
+    CHECK(m.sent[i].size() <= MIPSEND_BIN_CHUNK);
+    all.insert(all.end(), m.sent[i].begin(), m.sent[i].end());
+  }
+  CHECK(all == d);
+  CHECK(m.stream == d);
+  CHECK(m.wire.empty());
+}
+
+// 连续成功后窗口加深（不超过上限），数据按序完整进入流
+static void test_window_grows() {
+  fresh();
+  auto d = make_data(12000, 2);
+  CHECK(send_packet(d));
+  CHECK(m.stream == d);
+  CHECK(m.maxOutstanding > 1);
+  CHECK(m.maxOutstanding <= MIPSEND_WINDOW_MAX);
+  CHECK(m.answered == m.sent.size());
+  MipSendStats tot;
+  mipsend_get_total_stats(tot);
+  CHECK(tot.window > 1);
+}
+
+// last 统计按一次上传（begin/end 之间的所有包）累计
+static void test_upload_stats() {
+  fresh();
+  auto a = make_data(1000, 3);
+  auto b = make_data(2500, 4);
+  mipsend_upload_begin();
+  CHECK(send_packet(a));
+  CHECK(send_packet(b));
+  s_now += 100;
+  mipsend_upload_end();
+  MipSendStats last;
+  mipsend_get_last_stats(last);
+  CHECK(last.bytes_acked == a.size() + b.size());
+  CHECK(last.lines == m.sent.size());
+  CHECK(last.retransmits == 0);
+  CHECK(last.goodput_bps > 0);
+  // 区间外的包不计入 last
+  CHECK(send_packet(a));
+  MipSendStats again;
+  mipsend_get_last_stats(again);
+  CHECK(again.bytes_acked == last.bytes_acked);
+}
+
+// ---- 重传与失序 ----
+static MipSendStats total() {
+  MipSendStats t;
+  mipsend_get_total_stats(t);
+  return t;
+}
+
+// 拒绝从第 s_rejectAt 行起、当时已在途的所有行（窗口内整段被拒）
+static size_t s_rejectAt = 0;
+static size_t s_rejectEnd = 0;
+static bool accept_burst(size_t idx) {
+  if (idx == s_rejectAt) s_rejectEnd = m.sent.size();
+  return idx < s_rejectAt || idx >= s_rejectEnd;
+}
+
+static bool accept_one_hole(size_t idx) { return idx != s_rejectAt; }
+static bool accept_none(size_t) { return false; }
+static bool accept_first(size_t idx) { return idx == 0; }
+
+// 窗口内头部及其后全部被拒：按原顺序整段重发，流完整无重复
+static void test_go_back_n() {
+  fresh();
+  s_rejectAt = 60;   // 窗口已加深后再出错
+  s_rejectEnd = 0;
+  m.accept = accept_burst;
+  MipSendStats before = total();
+  auto d = make_data(12000, 5);
+  CHECK(send_packet(d));
+  CHECK(m.stream == d);
+  size_t burst = s_rejectEnd - s_rejectAt;
+  CHECK(burst >= 2);
+  CHECK(m.sent.size() >= s_rejectEnd + burst);
+  for (size_t i = 0; i < burst && s_rejectEnd + i < m.sent.size(); ++i) {
+    CHECK(m.sent[s_rejectEnd + i] == m.sent[s_rejectAt + i]);
+  }
+  MipSendStats after = total();
+  CHECK(after.retransmits - before.retransmits == burst);
+  CHECK(after.stream_errors == before.stream_errors);
+  CHECK(!mipsend_take_stream_error());
+}
+
+// 中间一行被拒而其后的行已被接受：流上有空洞，放弃本包并要求重连；
+// 连接管理取走错误之前不再发包
+static void test_stream_hole() {
+  fresh();
+  s_rejectAt = 60;
+  m.accept = accept_one_hole;
+  MipSendStats before = total();
+  CHECK(!send_packet(make_data(12000, 6)));
+  MipSendStats after = total();
+  CHECK(after.stream_errors - before.stream_errors == 1);
+  CHECK(after.retransmits == before.retransmits);
+
+  size_t lines = m.sent.size();
+  CHECK(!send_packet(make_data(200, 7)));
+  CHECK(m.sent.size() == lines);
+  CHECK(mipsend_take_stream_error());
+  CHECK(!mipsend_take_stream_error());
+
+  // 重连后旧连接的应答作废，新包正常发送
+  m.answered = m.sent.size();
+  m.accept = nullptr;
+  m.stream.clear();
+  auto d = make_data(200, 8);
+  CHECK(send_packet(d));
+  CHECK(m.stream == d);
+}
+
+// 重试用尽：尚无字节进入流时只放弃本包；已有字节被接受则判定失序
+static void test_retries_exhausted() {
+  fresh();
+  m.accept = accept_none;
+  CHECK(!send_packet(make_data(100, 9)));
+  CHECK(m.sent.size() == 3);
+  CHECK(m.sent[0] == m.sent[1] && m.sent[1] == m.sent[2]);
+  CHECK(!mipsend_take_stream_error());
+
+  fresh();
+  m.accept = accept_first;
+  CHECK(!send_packet(make_data(300, 10)));
+  CHECK(m.sent.size() == 4);
+  CHECK(mipsend_take_stream_error());
+}
+
+// 提示符模式：连续成功也不加深窗口，每块的命令都在上一块应答之后发出；出错按原块重发
+static bool accept_not_7(size_t idx) { return idx != 7; }
+
+static void test_binary_stop_and_wait() {
+  fresh();
+  mipsend_set_mode(MIPSEND_MODE_BINARY);
+  m.accept = accept_not_7;
+  auto d = make_data(40000, 12);
+  CHECK(send_packet(d));
+  CHECK(m.stream == d);
+  CHECK(m.sent.size() > 32);   // 足以在 HEX 模式下加深两次窗口
+  CHECK(m.maxOutstanding == 1);
+  CHECK(m.cmdWhileBusy == 0);
+  CHECK(m.sent[8] == m.sent[7]);
+  for (const auto& b : m.sent) CHECK(b.size() <= MIPSEND_RAW_CHUNK);
+  MipSendStats tot;
+  mipsend_get_total_stats(tot);
+  CHECK(tot.window == 1);
+  CHECK(!mipsend_take_stream_error());
+  mipsend_set_mode(MIPSEND_MODE_HEX);
+}
+
+// 模组不应答：超时放弃本包，计入超时并要求重连
+static void test_ack_timeout() {
+  fresh();
+  m.silent = true;
+  MipSendStats before = total();
+  CHECK(!send_packet(make_data(100, 11)));
+  MipSendStats after = total();
+  CHECK(after.timeouts - before.timeouts == 1);
+  CHECK(mipsend_take_stream_error());
+}
+
+// ---- 吞吐：整行组装一次写出 vs 旧的逐字节写出（前缀、每字节两个HEX字符、CRLF 分别写） ----
+static void old_per_byte_line(const uint8_t* data, size_t n) {
+  static const char* HEXCHARS = "0123456789ABCDEF";
+  Serial.write("AT+MIPSEND=0,0,");
+  for (size_t i = 0; i < n; ++i) {
+    uint8_t pair[2] = { (uint8_t)HEXCHARS[data[i] >> 4], (uint8_t)HEXCHARS[data[i] & 0x0F] };
+    Serial.write(pair, 2);
+  }
+  Serial.write("\r\n");
+}
+
+static void bench() {
+  auto d = make_data(64 * 1024, 9);
+  const int reps = 200;
+
+  fresh();
+  m.benchSink = true;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int r = 0; r < reps; ++r) {
+    for (size_t pos = 0; pos < d.size(); pos += MIPSEND_BIN_CHUNK) old_per_byte_line(d.data() + pos, MIPSEND_BIN_CHUNK);
+  }
+  double sOld = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  size_t callsOld = m.benchCalls;
+
+  fresh();
+  m.benchSink = true;
+  t0 = std::chrono::steady_clock::now();
+  for (int r = 0; r < reps; ++r) {
+    mipsend_begin();
+    mipsend_write(d.data(), d.size());
+    mipsend_end();
+  }
+  double sNew = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  size_t callsNew = m.benchCalls;
+
+  double bytes = (double)d.size() * reps;
+  double lines = bytes / MIPSEND_BIN_CHUNK;
+  printf("per-byte: %.1f MB/s, %.0f writes/line | LUT line (incl. ack handling): %.1f MB/s, %.1f writes/line\n",
+         bytes / sOld / 1e6, callsOld / lines, bytes / sNew / 1e6, callsNew / lines);
+}
+
+int main(int argc, char** argv) {
+  test_line_format();
+  test_window_grows();
+  test_upload_stats();
+  test_go_back_n();
+  test_stream_hole();
+  test_retries_exhausted();
+  test_ack_timeout();
+  test_binary_stop_and_wait();
+  if (s_fail) {
+    printf("mipsend_test: %d failure(s)\n", s_fail);
+    return 1;
+  }
+  printf("mipsend_test: OK\n");
+  if (argc > 1 && strcmp(argv[1], "--bench") == 0) bench();
+  return 0;
+}
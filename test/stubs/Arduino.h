@@ -0,0 +1,21 @@
+#pragma once
+// 主机测试用的最小 Arduino 替身：只提供被测模块用到的声明，时钟与串口由各测试实现
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define HIGH 1
+#define LOW  0
+
+uint32_t millis();
+uint32_t micros();
+void delay(uint32_t ms);
+
+class HardwareSerial {
+public:
+  size_t write(const uint8_t* data, size_t len);
+  size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+};
+extern HardwareSerial Serial;
@@ -0,0 +1,2 @@
+#pragma once
+typedef enum { FRAMESIZE_QVGA, FRAMESIZE_VGA, FRAMESIZE_SVGA } framesize_t;
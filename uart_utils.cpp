@@ -1,6 +1,12 @@
 #include "uart_utils.h"
 #include "config.h"
 #include "rtc_soft.h"
+#include "dl_frame.h"
+#include "dl_dispatch.h"
+#include "dtu_rx.h"
+#include "dtu_tx.h"
+#include "link_stats.h"
+#include "ul_ack.h"
 
 // Line buffer
 static char lineBuf[LINE_BUF_MAX];
@@ -42,18 +48,15 @@ static void dumpHex(const uint8_t* d, int n)
 #endif
 }
 
-// 解析平台时间包（仅CMD=0x0001时）
-bool parsePlatformTime(const uint8_t* data, size_t len, PlatformTime* time) {
-  if (len < 32) return false;
-  if (data[0] != '$') return false;
-  uint16_t cmd = (data[17] << 8) | data[18];
-  if (cmd != 0x0001) return false;
-  time->year = (data[23] << 8) | data[24];
-  time->month = data[25];
-  time->day = data[26];
-  time->hour = data[27];
-  time->minute = data[28];
-  time->second = data[29];
+// 解析时间 payload（年2字节大端 + 月日时分秒），范围检查失败返回 false
+static bool parseTimePayload(const uint8_t* p, size_t len, PlatformTime* time) {
+  if (len < 7) return false;
+  time->year = (p[0] << 8) | p[1];
+  time->month = p[2];
+  time->day = p[3];
+  time->hour = p[4];
+  time->minute = p[5];
+  time->second = p[6];
   if (time->year < 2000 || time->year > 2100 ||
       time->month < 1 || time->month > 12 ||
       time->day < 1 || time->day > 31 ||
@@ -84,67 +87,103 @@ bool parsePlatformTime(const uint8_t* data, size_t len, PlatformTime* time) {
   return true;
 }
 
-// 按协议头动态接收完整包，并只在CMD=0x0001时解析时间
-void readDTU() {
-  static uint8_t packetBuf[256];
-  static size_t packetLen = 0;
-  static size_t expectedPacketLen = 0;
-
-  while (Serial.available()) {
-    uint8_t c = Serial.read();
-
-    // 检查是否是数据包开始 (0x24)
-    if (packetLen == 0 && c == 0x24) {
-      packetBuf[packetLen++] = c;
-      expectedPacketLen = 0;
-      continue;
-    }
-    // 如果已经开始接收数据包
-    if (packetLen > 0) {
-      packetBuf[packetLen++] = c;
-      if (packetLen == 4) {
-        // 已收到头4字节，可以解析长度
-        uint16_t dataLen = (packetBuf[2] << 8) | packetBuf[3];
-        expectedPacketLen = 21 + 2 + dataLen + (dataLen > 0 ? 2 : 0);
-        if (expectedPacketLen > sizeof(packetBuf)) expectedPacketLen = sizeof(packetBuf); // 防溢出
-      }
-      // 收齐一包再处理
-      if (expectedPacketLen > 0 && packetLen >= expectedPacketLen) {
-        dumpHex(packetBuf, packetLen);
-        // 只在CMD=0x0001时解析时间
-        if (packetLen >= 32) {
-          uint16_t cmd = (packetBuf[17] << 8) | packetBuf[18];
-          if (cmd == 0x0001) {
-            PlatformTime parsedTime;
-            if (parsePlatformTime(packetBuf, packetLen, &parsedTime)) {
-              g_platformTime = parsedTime;
-              g_platformTimeParsed = true;
-              rtc_on_sync(&parsedTime, millis()); // 新增：收到即校RTC
-            }
-          }
-        }
-        packetLen = 0;
-        expectedPacketLen = 0;
-      }
-      if (packetLen >= sizeof(packetBuf)) {
-        packetLen = 0;
-        expectedPacketLen = 0;
-      }
-      continue;
+// 解析平台时间包（仅CMD=0x0001时），data 为完整包
+bool parsePlatformTime(const uint8_t* data, size_t len, PlatformTime* time) {
+  if (len < 32) return false;
+  if (data[0] != '$') return false;
+  uint16_t cmd = (data[17] << 8) | data[18];
+  if (cmd != 0x0001) return false;
+  return parseTimePayload(data + DL_FRAME_HEAD_LEN, len - DL_FRAME_HEAD_LEN, time);
+}
+
+// 平台时间应答（cmd 与请求相同，0x0001）
+static void onTimeSyncFrame(const DlFrame* f, void*) {
+  dumpHex(f->head, DL_FRAME_HEAD_LEN);
+  link_stats_on_reply(CMD_TIME_SYNC_REQ);
+  uint8_t p[7];
+  if (dl_frame_copy(f, 0, p, sizeof(p)) != sizeof(p)) return;
+  PlatformTime parsedTime;
+  if (parseTimePayload(p, sizeof(p), &parsedTime)) {
+    g_platformTime = parsedTime;
+    g_platformTimeParsed = true;
+    rtc_on_sync(&parsedTime, millis()); // 收到即校RTC
+  }
+}
+
+// 平台心跳应答：仅用于统计往返时间
+static void onHeartbeatFrame(const DlFrame*, void*) {
+  link_stats_on_reply(CMD_HEARTBEAT_REQ);
+}
+
+// 文本字节：按行分发（下行帧由 dl_frame 解码，不经过这里）
+static void feedTextByte(uint8_t c) {
+  if (c == '\r' || c == '\n') {
+    if (lineLen > 0) {
+      lineBuf[lineLen] = '\0';
+      if (lineHandler) lineHandler(lineBuf);
+      lineLen = 0;
     }
-    // 文本行模式
-    if (c == '\r' || c == '\n') {
-      if (lineLen > 0) {
-        lineBuf[lineLen] = '\0';
-        if (lineHandler) lineHandler(lineBuf);
-        lineLen = 0;
-      }
+  } else {
+    if (lineLen < LINE_BUF_MAX - 1) {
+      lineBuf[lineLen++] = (char)c;
     } else {
-      if (lineLen < LINE_BUF_MAX - 1) {
-        lineBuf[lineLen++] = (char)c;
-      } else {
-        lineLen = 0;
-      }
+      lineLen = 0;
+    }
+  }
+}
+
+// 下行帧：先核对上行确认窗口（应答与请求同 cmd、同 pid），再按 cmd 分发
+static void onDownlinkFrame(const DlFrame* f) {
+  ul_ack_on_frame(f->cmd, f->pid);
+  dl_dispatch_frame(f);
+}
+
+static void ensureDownlink() {
+  static bool inited = false;
+  if (inited) return;
+  inited = true;
+  dl_frame_init();
+  dl_frame_set_text_sink(feedTextByte);
+  dl_frame_set_handler(onDownlinkFrame);
+  dl_dispatch_register(CMD_TIME_SYNC_REQ, onTimeSyncFrame);
+  dl_dispatch_register(CMD_HEARTBEAT_REQ, onHeartbeatFrame);
+}
+
+// 读取DTU数据：下行帧交给 dl_frame 流式解码（校验双CRC）后按 cmd 分发，其余按文本行分发
+// 帧体内的字节不会触发任何回调，整块读入；其余逐字节读，保证回调中嵌套读取时不乱序
+// 发送任务持有链路锁时由它读取（应答须交给 mipsend），其它任务直接返回
+void readDTU() {
+  if (!dtu_link_lock()) return;
+  ensureDownlink();
+  uint8_t buf[128];
+  while (dtu_rx_available()) {
+    size_t want = dl_frame_body_remaining();
+    if (want > sizeof(buf)) want = sizeof(buf);
+    if (want < 1) want = 1;
+    size_t n = dtu_rx_read(buf, want);
+    if (n == 0) break;
+    dl_frame_feed(buf, n);
+  }
+  dl_frame_poll(millis());
+  dtu_link_unlock();
+}
+
+// 等待模组的输入提示符（如 '>'）：仅在行首、且不在下行帧中时识别，
+// 等待期间收到的其它字节照常走帧/行分发，不丢失URC；无数据时阻塞在接收事件上
+bool dtu_wait_prompt(char prompt, uint32_t timeoutMs) {
+  ensureDownlink();
+  uint32_t t0 = millis();
+  for (;;) {
+    int c;
+    while ((c = dtu_rx_read_byte()) >= 0) {
+      if (c == (uint8_t)prompt && !dl_frame_active() && lineLen == 0) return true;
+      uint8_t b = (uint8_t)c;
+      dl_frame_feed(&b, 1);
     }
+    dl_frame_poll(millis());
+    uint32_t el = millis() - t0;
+    if (el >= timeoutMs) return false;
+    dtu_rx_wait(timeoutMs - el);
   }
-}
\ No newline at end of file
+}
+
@@ -16,6 +16,8 @@ void sendRaw(const char* s);
 void sendCmd(const char* cmd);
 
 void readDTU();
+// 等待模组输入提示符，期间收到的其它数据照常分发；超时返回false
+bool dtu_wait_prompt(char prompt, uint32_t timeoutMs);
 void setLineHandler(void (*handler)(const char*));
 
 // 时间包解析成功标志（外部可读）
@@ -0,0 +1,301 @@
+#include "ul_ack.h"
+#include "comm_manager.h"
+#include <freertos/FreeRTOS.h>
+
+enum : uint8_t { ACK_FREE = 0, ACK_QUEUED, ACK_SENT, ACK_DUE, ACK_FAILED };
+
+struct AckSlot {
+  uint8_t  state;
+  uint8_t  seq;
+  uint8_t  tries;       // 已重传次数
+  bool     isJob;
+  uint8_t  prio;
+  char     opType;
+  uint16_t cmd;
+  uint16_t tag;         // 作业包的片号
+  uint16_t len;
+  uint32_t sentMs;
+  uint8_t  payload[DTU_TX_INLINE_MAX];
+};
+
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+static AckSlot    s_slot[UL_ACK_WINDOW];
+static uint8_t    s_seq = 0;
+static bool       s_wasConnected = false;
+static UlAckStats s_st;
+
+// 以下 *_locked 函数须在临界区内调用
+static bool seq_in_use_locked(uint8_t seq) {
+  for (uint8_t i = 0; i < UL_ACK_WINDOW; ++i) {
+    if (s_slot[i].state != ACK_FREE && s_slot[i].seq == seq) return true;
+  }
+  return false;
+}
+
+static uint8_t next_seq_locked() {
+  // 跳过 0 和窗口中仍在等待确认的序号（回绕后不与旧包混淆）
+  do {
+    if (++s_seq == 0) s_seq = 1;
+  } while (seq_in_use_locked(s_seq));
+  return s_seq;
+}
+
+static AckSlot* find_locked(uint8_t seq) {
+  if (seq == 0) return nullptr;
+  for (uint8_t i = 0; i < UL_ACK_WINDOW; ++i) {
+    if (s_slot[i].state != ACK_FREE && s_slot[i].seq == seq) return &s_slot[i];
+  }
+  return nullptr;
+}
+
+static AckSlot* alloc_locked() {
+  for (uint8_t i = 0; i < UL_ACK_WINDOW; ++i) {
+    if (s_slot[i].state == ACK_FREE) {
+      if (++s_st.inflight > s_st.high_water) s_st.high_water = s_st.inflight;
+      s_st.tracked++;
+      return &s_slot[i];
+    }
+  }
+  s_st.window_full++;
+  return nullptr;
+}
+
+static void free_locked(AckSlot& s) {
+  s.state = ACK_FREE;
+  s_st.inflight--;
+}
+
+uint8_t ul_ack_next_seq() {
+  portENTER_CRITICAL(&s_mux);
+  uint8_t seq = next_seq_locked();
+  portEXIT_CRITICAL(&s_mux);
+  return seq;
+}
+
+bool ul_ack_send_packet(TxPrio prio, char opType, uint16_t cmd,
+                        const uint8_t* payload, uint16_t payloadLen) {
+  if (payloadLen > DTU_TX_INLINE_MAX) return false;
+#if UL_ACK_ENABLE
+  portENTER_CRITICAL(&s_mux);
+  AckSlot* s = alloc_locked();
+  uint8_t seq = 0;
+  if (s) {
+    seq = next_seq_locked();
+    s->state = ACK_QUEUED;
+    s->seq = seq;
+    s->tries = 0;
+    s->isJob = false;
+    s->prio = prio;
+    s->opType = opType;
+    s->cmd = cmd;
+    s->tag = 0;
+    s->len = payloadLen;
+    if (payloadLen) memcpy(s->payload, payload, payloadLen);
+  }
+  portEXIT_CRITICAL(&s_mux);
+  if (!s) return false;
+  // 同步发送退路下 on_sent 在入队函数内已回报，此时槽位已是 SENT
+  if (dtu_tx_submit_packet(prio, opType, cmd, seq, payload, payloadLen)) return true;
+  portENTER_CRITICAL(&s_mux);
+  AckSlot* f = find_locked(seq);
+  if (f) {
+    free_locked(*f);
+    s_st.tracked--;
+  }
+  portEXIT_CRITICAL(&s_mux);
+  return false;
+#else
+  return dtu_tx_submit_packet(prio, opType, cmd, ul_ack_next_seq(), payload, payloadLen);
+#endif
+}
+
+uint8_t ul_ack_open(uint16_t cmd, uint16_t tag) {
+#if UL_ACK_ENABLE
+  portENTER_CRITICAL(&s_mux);
+  AckSlot* s = alloc_locked();
+  uint8_t seq = 0;
+  if (s) {
+    seq = next_seq_locked();
+    s->state = ACK_QUEUED;
+    s->seq = seq;
+    s->tries = 0;
+    s->isJob = true;
+    s->cmd = cmd;
+    s->tag = tag;
+    s->len = 0;
+  }
+  portEXIT_CRITICAL(&s_mux);
+  return seq;
+#else
+  (void)cmd;
+  (void)tag;
+  return ul_ack_next_seq();
+#endif
+}
+
+void ul_ack_on_sent(uint8_t seq, bool ok) {
+  portENTER_CRITICAL(&s_mux);
+  AckSlot* s = find_locked(seq);
+  if (s && s->state == ACK_QUEUED) {
+    s->state = ok ? ACK_SENT : ACK_DUE;
+    s->sentMs = millis();
+  }
+  portEXIT_CRITICAL(&s_mux);
+}
+
+void ul_ack_on_frame(uint16_t cmd, uint8_t pid) {
+  if (pid == 0) return;   // 平台主动下发
+  uint32_t now = millis();
+  portENTER_CRITICAL(&s_mux);
+  AckSlot* s = find_locked(pid);
+  if (s && s->cmd == cmd) {
+    if (s->state == ACK_SENT && now - s->sentMs > s_st.ack_max_ms) {
+      s_st.ack_max_ms = now - s->sentMs;
+    }
+    // 重传已入队时收到对上一次的应答也算确认，重传包到达平台后按序号去重
+    free_locked(*s);
+    s_st.acked++;
+  } else if (cmd != CMD_HEARTBEAT_REQ && cmd != CMD_TIME_SYNC_REQ) {
+    s_st.unmatched++;
+  }
+  portEXIT_CRITICAL(&s_mux);
+}
+
+bool ul_ack_take_due(uint16_t cmd, uint16_t* tag, uint8_t* seq) {
+  bool found = false;
+  portENTER_CRITICAL(&s_mux);
+  AckSlot* pick = nullptr;
+  for (uint8_t i = 0; i < UL_ACK_WINDOW; ++i) {
+    AckSlot& s = s_slot[i];
+    if (s.state != ACK_DUE || !s.isJob || s.cmd != cmd) continue;
+    if (!pick || s.tag < pick->tag) pick = &s;   // 靠前的片先补
+  }
+  if (pick) {
+    pick->state = ACK_QUEUED;
+    pick->tries++;
+    s_st.retrans++;
+    *tag = pick->tag;
+    *seq = pick->seq;
+    found = true;
+  }
+  portEXIT_CRITICAL(&s_mux);
+  return found;
+}
+
+static bool any_locked(uint16_t cmd, bool failed) {
+  for (uint8_t i = 0; i < UL_ACK_WINDOW; ++i) {
+    const AckSlot& s = s_slot[i];
+    if (s.state == ACK_FREE || s.cmd != cmd) continue;
+    if ((s.state == ACK_FAILED) == failed) return true;
+  }
+  return false;
+}
+
+bool ul_ack_pending(uint16_t cmd) {
+  portENTER_CRITICAL(&s_mux);
+  bool any = any_locked(cmd, false);
+  portEXIT_CRITICAL(&s_mux);
+  return any;
+}
+
+bool ul_ack_failed(uint16_t cmd) {
+  portENTER_CRITICAL(&s_mux);
+  bool any = any_locked(cmd, true);
+  portEXIT_CRITICAL(&s_mux);
+  return any;
+}
+
+void ul_ack_rearm(uint16_t cmd) {
+  portENTER_CRITICAL(&s_mux);
+  for (uint8_t i = 0; i < UL_ACK_WINDOW; ++i) {
+    AckSlot& s = s_slot[i];
+    if (s.state != ACK_FAILED || s.cmd != cmd) continue;
+    s.state = ACK_DUE;
+    s.tries = 0;
+  }
+  portEXIT_CRITICAL(&s_mux);
+}
+
+UlAckSeqState ul_ack_seq_state(uint8_t seq) {
+  portENTER_CRITICAL(&s_mux);
+  AckSlot* s = find_locked(seq);
+  UlAckSeqState st = UL_ACK_SEQ_DONE;
+  if (s) st = (s->state == ACK_QUEUED || s->state == ACK_SENT) ? UL_ACK_SEQ_WAIT : UL_ACK_SEQ_LOST;
+  portEXIT_CRITICAL(&s_mux);
+  return st;
+}
+
+void ul_ack_release(uint8_t seq) {
+  portENTER_CRITICAL(&s_mux);
+  AckSlot* s = find_locked(seq);
+  if (s) free_locked(*s);
+  portEXIT_CRITICAL(&s_mux);
+}
+
+void ul_ack_cancel(uint16_t cmd, uint16_t fromTag) {
+  portENTER_CRITICAL(&s_mux);
+  for (uint8_t i = 0; i < UL_ACK_WINDOW; ++i) {
+    AckSlot& s = s_slot[i];
+    if (s.state != ACK_FREE && s.cmd == cmd && s.tag >= fromTag) free_locked(s);
+  }
+  portEXIT_CRITICAL(&s_mux);
+}
+
+void ul_ack_poll(uint32_t now) {
+#if UL_ACK_ENABLE
+  bool conn = comm_isConnected();
+  bool reconnected = conn && !s_wasConnected;
+  s_wasConnected = conn;
+  if (!conn) return;   // 断链期间不计超时
+
+  portENTER_CRITICAL(&s_mux);
+  for (uint8_t i = 0; i < UL_ACK_WINDOW; ++i) {
+    AckSlot& s = s_slot[i];
+    if (s.state != ACK_SENT) continue;
+    // 重连：旧连接上未确认的包多半已丢失，不等超时立即补发
+    if (!reconnected && now - s.sentMs < UL_ACK_TIMEOUT_MS) continue;
+    if (s.tries >= UL_ACK_RETRY_MAX) {
+      // 小包直接丢弃；作业包留给发送方判定本轮失败
+      if (s.isJob) s.state = ACK_FAILED;
+      else free_locked(s);
+      s_st.given_up++;
+      continue;
+    }
+    s.state = ACK_DUE;
+  }
+  portEXIT_CRITICAL(&s_mux);
+
+  // 小包重新入队（原序号），作业包由发送方经 ul_ack_take_due 取走
+  for (uint8_t i = 0; i < UL_ACK_WINDOW; ++i) {
+    AckSlot c;
+    portENTER_CRITICAL(&s_mux);
+    AckSlot& s = s_slot[i];
+    bool due = (s.state == ACK_DUE && !s.isJob);
+    if (due) {
+      s.state = ACK_QUEUED;
+      s.tries++;
+      c = s;
+    }
+    portEXIT_CRITICAL(&s_mux);
+    if (!due) continue;
+    bool ok = dtu_tx_submit_packet((TxPrio)c.prio, c.opType, c.cmd, c.seq, c.payload, c.len);
+    portENTER_CRITICAL(&s_mux);
+    if (ok) {
+      s_st.retrans++;
+    } else if (s.state == ACK_QUEUED && s.seq == c.seq) {
+      s.state = ACK_DUE;   // 队列满：下一轮再试
+      s.tries--;
+    }
+    portEXIT_CRITICAL(&s_mux);
+    if (!ok) break;
+  }
+#else
+  (void)now;
+#endif
+}
+
+void ul_ack_get_stats(UlAckStats& out) {
+  portENTER_CRITICAL(&s_mux);
+  out = s_st;
+  portEXIT_CRITICAL(&s_mux);
+}
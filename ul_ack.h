@@ -0,0 +1,69 @@
+#pragma once
+#include <Arduino.h>
+#include "config.h"
+#include "dtu_tx.h"
+
+// 上行确认窗口：每个上行包在协议头 pid 中携带序号（1..255 循环，0 保留），
+// 平台应答以相同 cmd + pid 回送即视为确认。需要可靠送达的包在窗口中登记，
+// 模组确认发出后开始计时；超时或断链重连后只重传未确认的包，已确认的不再重发。
+// 窗口满（UL_ACK_WINDOW）时登记失败，发送方按背压处理（下一轮再试）
+//
+// 小包：由本模块保存 payload 副本并自动重传；
+// 作业包（事件图片各片）：只登记序号与 tag（片号），数据由发送方在重传时重新读取；
+// 重传用尽的作业包不释放，标记为失败由发送方查询（ul_ack_failed），不能当作已送达
+
+struct UlAckStats {
+  uint32_t tracked = 0;      // 登记的可靠包
+  uint32_t acked = 0;
+  uint32_t retrans = 0;      // 重传次数
+  uint32_t given_up = 0;     // 重传用尽仍未确认
+  uint32_t window_full = 0;  // 登记时窗口已满
+  uint32_t unmatched = 0;    // 应答不对应窗口中的包（重复应答或已放弃；心跳/校时不计）
+  uint32_t inflight = 0;     // 当前窗口占用
+  uint32_t high_water = 0;
+  uint32_t ack_max_ms = 0;   // 发出到确认的最长时间
+};
+
+// 不需要确认的包（心跳、校时）也带序号
+uint8_t ul_ack_next_seq();
+
+// 可靠小包：分配序号、登记并入发送队列；窗口满或队列满返回 false
+bool ul_ack_send_packet(TxPrio prio, char opType, uint16_t cmd,
+                        const uint8_t* payload, uint16_t payloadLen);
+
+// 作业包：登记并返回序号，由调用方以该序号发送；窗口满返回 0
+uint8_t ul_ack_open(uint16_t cmd, uint16_t tag);
+
+// 发送结果（发送任务中调用）：ok=已交给模组，开始计时；否则标记待重传
+void ul_ack_on_sent(uint8_t seq, bool ok);
+
+// 下行帧到达（readDTU 分发前调用）
+void ul_ack_on_frame(uint16_t cmd, uint8_t pid);
+
+// 作业包：取出一个待重传的登记（tag、原序号），调用方须以原序号重发并回报 ul_ack_on_sent
+bool ul_ack_take_due(uint16_t cmd, uint16_t* tag, uint8_t* seq);
+
+// 该 cmd 是否仍有等待确认或待重传的登记（不含已失败的）
+bool ul_ack_pending(uint16_t cmd);
+
+// 该 cmd 是否有重传用尽仍未确认的作业包
+bool ul_ack_failed(uint16_t cmd);
+
+// 该 cmd 已失败的作业包重新计重传次数并标记待重传（发送方开始新一轮时调用）
+void ul_ack_rearm(uint16_t cmd);
+
+// 作业包按序号查询：DONE=已确认（或未登记，确认关闭时即发出），WAIT=排队或等待确认，
+// LOST=超时待补或重传用尽；逐条交付的发送方（离线日志）据此决定何时越过记录
+enum UlAckSeqState : uint8_t { UL_ACK_SEQ_DONE = 0, UL_ACK_SEQ_WAIT, UL_ACK_SEQ_LOST };
+UlAckSeqState ul_ack_seq_state(uint8_t seq);
+
+// 注销单个序号的登记（发送方将以新序号重发）
+void ul_ack_release(uint8_t seq);
+
+// 注销该 cmd 中 tag >= fromTag 的登记（发送方将以新序号重发，或数据已作废）
+void ul_ack_cancel(uint16_t cmd, uint16_t fromTag);
+
+// 主循环调用：确认超时、重连后标记重传，小包直接重新入队
+void ul_ack_poll(uint32_t now);
+
+void ul_ack_get_stats(UlAckStats& out);
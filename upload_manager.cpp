@@ -4,6 +4,17 @@
 #include "comm_manager.h"
 #include "rtc_soft.h"
 #include "sd_async.h"
+#include "photo_stream.h"
+#include "photo_sidecar.h"
+#include "crc16.h"
+#include "upload_xfer.h"
+#include "dtu_tx.h"
+#include "mipsend.h"
+#include "link_stats.h"
+#include "ul_ack.h"
+#include "sd_journal.h"
+#include "rt_batch.h"
+#include "uart_utils.h"
 #include <Arduino.h>
 #include <FS.h>
 #include <SD.h>
@@ -57,34 +68,56 @@ static void water_auto_capture_upload_if_needed(uint32_t now) {
     }
 }
 
+// SIM信息经AT引擎异步采集，结果在回调中暂存，下一轮主循环再上报
+static SimInfo  s_sim;
+static bool     s_simPending = false;   // 采集进行中
+static bool     s_simReady = false;     // 已采集成功，待上报
+static uint32_t s_simLastTryMs = 0;
+
+static void onSimInfo(const SimInfo* sim, void*) {
+    s_simPending = false;
+    if (!sim->valid) {
+        log2("[SIMUP] SIM info collect fail, skip upload.");
+        return;
+    }
+    s_sim = *sim;
+    s_simReady = true;
+}
+
 static void uploadSimInfoIfNeeded() {
-    if (g_simInfoUploaded) return;
+    if (g_simInfoUploaded || s_simPending) return;
     if (!comm_isConnected()) return;
     if (!rtc_is_valid()) {
         log2("[SIMUP] RTC not valid, skip.");
         return;
     }
 
-    log2("[SIMUP] Try collect SIM info");
-    SimInfo sim;
-    if (!siminfo_query(&sim)) {
-        log2("[SIMUP] SIM info collect fail, skip upload.");
+    if (!s_simReady) {
+        uint32_t now = millis();
+        if (s_simLastTryMs && now - s_simLastTryMs < SIM_QUERY_RETRY_MS) return;
+        // AT引擎属于链路：发送任务正在发包时下一轮再采集
+        if (!dtu_link_lock()) return;
+        s_simLastTryMs = now;
+        log2("[SIMUP] Try collect SIM info");
+        s_simPending = siminfo_query_async(onSimInfo);
+        dtu_link_unlock();
         return;
     }
 
     PlatformTime t;
     rtc_now_fields(&t);
 
-    log2Str("[SIMUP] Ready upload ICCID: ", sim.iccid);
-    log2Str("[SIMUP] Ready upload IMSI: ", sim.imsi);
+    log2Str("[SIMUP] Ready upload ICCID: ", s_sim.iccid);
+    log2Str("[SIMUP] Ready upload IMSI: ", s_sim.imsi);
 
-    sendSimInfoUpload(
-        t.year, t.month, t.day, t.hour, t.minute, t.second,
-        sim.iccid, sim.iccid_len,
-        sim.imsi,  sim.imsi_len,
-        sim.signal
-    );
-    log2("[SIMUP] SIM info upload sent.");
+    if (!sendSimInfoUpload(
+            t.year, t.month, t.day, t.hour, t.minute, t.second,
+            s_sim.iccid, s_sim.iccid_len,
+            s_sim.imsi,  s_sim.imsi_len,
+            s_sim.signal)) {
+        return;  // 发送队列满，下一轮再试
+    }
+    log2("[SIMUP] SIM info upload queued.");
     g_simInfoUploaded = true;
 }
 
@@ -97,20 +130,36 @@ static void uploadStartupStatusIfNeeded() {
     rtc_now_fields(&t);
 
     // CMD=0x0002开机状态上报
-    sendStartupStatusReport(
-        t.year, t.month, t.day, t.hour, t.minute, t.second,
-        0
-    );
+    if (!sendStartupStatusReport(
+            t.year, t.month, t.day, t.hour, t.minute, t.second,
+            0)) {
+        return;
+    }
     g_startupReported = true;
 }
 
+// 实时数据类小包：连接时经确认窗口发送，断链时记入离线日志（重连后补传）
+static bool emitRealtimePacket(uint16_t cmd, const uint8_t* payload, uint16_t len) {
+    if (comm_isConnected()) return sendStoredPacket(cmd, payload, len);
+#if JOURNAL_ENABLE
+    uint8_t rec[2 + DTU_TX_INLINE_MAX];
+    rec[0] = (uint8_t)(cmd >> 8);
+    rec[1] = (uint8_t)(cmd & 0xFF);
+    memcpy(rec + 2, payload, len);
+    sd_journal_append(JRNL_PACKET, rec, 2 + len);   // 失败计入日志统计，不重试
+    return true;
+#else
+    return false;
+#endif
+}
+
+#if REALTIME_BATCH_SIZE > 1
+static uint8_t s_rtLastStatus = 0xFF;   // 上一条样本的告警状态，0xFF=尚无样本
+#endif
+
+// 每 REALTIME_UPLOAD_INTERVAL_MS 采样一次；批量模式下告警状态变化时立即补采一条并整批发出
 static void uploadRealtimeDataIfNeeded(uint32_t now) {
-    if (!comm_isConnected()) return;
     if (!rtc_is_valid()) return;
-    if (now - lastRealtimeUploadMs < REALTIME_UPLOAD_INTERVAL_MS) return;
-
-    PlatformTime t;
-    rtc_now_fields(&t);
 
     uint8_t exceptionStatus = 0;
     if (!camera_ok) exceptionStatus |= 0x01;
@@ -118,102 +167,628 @@ static void uploadRealtimeDataIfNeeded(uint32_t now) {
 
     uint8_t waterStatus = g_waterSensorStatus ? 1 : 0;
 
-    sendRealtimeMonitorData(
-        t.year, t.month, t.day, t.hour, t.minute, t.second,
-        0,
-        &exceptionStatus,
-        waterStatus
-    );
+#if REALTIME_BATCH_SIZE > 1
+    uint8_t status = (uint8_t)(exceptionStatus | (waterStatus << 7));
+    bool edge = (s_rtLastStatus != 0xFF && status != s_rtLastStatus);
+    if (edge || now - lastRealtimeUploadMs >= REALTIME_UPLOAD_INTERVAL_MS) {
+        PlatformTime t;
+        rtc_now_fields(&t);
+        rt_batch_add(t, rtc_now(), exceptionStatus, waterStatus, edge, now);
+        lastRealtimeUploadMs = now;
+        s_rtLastStatus = status;
+    }
+    RtFlushReason why = rt_batch_due(now);
+    if (why == RT_FLUSH_NONE) return;
+    uint8_t payload[DTU_TX_INLINE_MAX];
+    uint16_t len = rt_batch_encode(payload, sizeof(payload));
+    // 发送队列或确认窗口满：保留本批，下一轮再试
+    if (len && emitRealtimePacket(CMD_REALTIME_BATCH, payload, len)) rt_batch_sent(why);
+#else
+    if (now - lastRealtimeUploadMs < REALTIME_UPLOAD_INTERVAL_MS) return;
+
+    PlatformTime t;
+    rtc_now_fields(&t);
+    uint8_t payload[REALTIME_PAYLOAD_LEN];
+    uint16_t len = buildRealtimeMonitorPayload(
+        payload, t.year, t.month, t.day, t.hour, t.minute, t.second,
+        0, &exceptionStatus, waterStatus);
+    if (!emitRealtimePacket(CMD_REALTIME_DATA, payload, len)) return;
 
     lastRealtimeUploadMs = now;
+#endif
 }
 
-// 将 g_lastPhotoName 指向的文件读取到内存（≤65000），成功返回malloc的指针与长度
-static uint8_t* read_photo_into_ram(size_t& outLen) {
+// 链路统计：窗口结束时上报上一窗口（未连接或RTC无效则只保留在本地）
+static void uploadLinkStatsIfNeeded(uint32_t now) {
+    if (!link_stats_roll(now)) return;
+#if LINK_STATS_UPLOAD
+    if (!comm_isConnected() || !rtc_is_valid()) return;
+    PlatformTime t;
+    rtc_now_fields(&t);
+    uint8_t payload[DTU_TX_INLINE_MAX];
+    size_t len = link_stats_encode(payload, sizeof(payload), t);
+    if (len) sendLinkStatsUpload(payload, (uint16_t)len);
+#endif
+}
+
+// 旁路记录与回读数据连续不一致的次数；达到上限后视为记录过期，改用实际数据计算CRC
+static uint8_t s_sidecarMismatch = 0;
+#define SIDECAR_MISMATCH_MAX 2
+
+// 当前事件图片的传输记录（NVS持久化），valid 表示与 g_lastPhotoName 对应
+static UploadXfer s_xfer;
+static bool s_xferValid = false;
+
+// 打开事件图片（≤PHOTO_UPLOAD_MAX_BYTES）供流式上传，成功返回true并输出整图长度
+// 从 offset 处开始预取（续传）；文件由 photo_stream 双缓冲预取，发送时边读边发；
+// 存在有效旁路记录（长度一致）时输出写卡时记录的CRC，hasCrc=false 表示需边发边算
+static bool open_photo_for_upload(const char* path, uint32_t offset, size_t& outLen, bool& hasCrc, uint16_t& crc) {
     outLen = 0;
-    if (!g_lastPhotoName[0]) return nullptr;
+    hasCrc = false;
+    crc = 0;
+    if (!path[0]) return false;
 
     // 如果启用异步写，且还未空闲，则暂缓上传，等下一轮
     if (g_cfg.asyncSDWrite && !sd_async_idle()) {
-        return nullptr;
+        return false;
     }
 
-    File f = SD.open(g_lastPhotoName, FILE_READ);
-    if (!f) {
-        Serial.println("[UPLOAD] Photo file open failed!");
-        return nullptr;
+    uint32_t sz = 0;
+    if (!photo_stream_open(path, offset, 0, &sz)) {
+        log2("[UPLOAD] Photo file open failed!");
+        return false;
     }
-    size_t sz = f.size();
+    sz += offset;
     if (sz == 0) {
-        f.close();
-        Serial.println("[UPLOAD] Photo file size=0!");
-        return nullptr;
-    }
-    if (sz > 65000) {
-        f.close();
-        Serial.println("[UPLOAD] Photo too large (>65K), skip upload.");
-        return nullptr;
-    }
-    uint8_t* buf = (uint8_t*)malloc(sz);
-    if (!buf) {
-        f.close();
-        Serial.println("[UPLOAD] malloc failed for photo buffer!");
-        return nullptr;
-    }
-    size_t n = f.read(buf, sz);
-    f.close();
-    if (n != sz) {
-        free(buf);
-        Serial.println("[UPLOAD] Photo read size mismatch!");
-        return nullptr;
+        photo_stream_close();
+        log2("[UPLOAD] Photo file size=0!");
+        return false;
+    }
+    if (sz > PHOTO_UPLOAD_MAX_BYTES) {
+        photo_stream_close();
+        log2("[UPLOAD] Photo too large, skip upload.");
+        return false;
     }
     outLen = sz;
-    return buf;
+#if PHOTO_SIDECAR_ENABLE
+    PhotoSidecar rec;
+    if (s_sidecarMismatch < SIDECAR_MISMATCH_MAX &&
+        photo_sidecar_read(path, &rec) && rec.len == sz) {
+        hasCrc = true;
+        crc = rec.crc16;
+    }
+#endif
+    return true;
+}
+
+// 数据源旁路：转发 photo_stream 的数据并累加已发送图片前缀的CRC
+static size_t photo_crc_tap_source(void* ctx, uint8_t* buf, size_t maxLen) {
+    size_t n = photo_stream_source(nullptr, buf, maxLen);
+    crc16_update((Crc16Ctx*)ctx, buf, n);
+    return n;
+}
+
+void upload_restore_pending() {
+    UploadXfer x;
+    if (!xfer_load(&x)) return;
+    if (!SD.exists(x.path)) {
+        xfer_clear(&x);
+        return;
+    }
+#if XFER_RESUME_REWIND
+    // 重启前已确认的最后一片可能还在模组缓冲中未送达
+    xfer_rewind(&x);
+#endif
+    s_xfer = x;
+    s_xferValid = true;
+    strncpy(g_lastPhotoName, x.path, sizeof(g_lastPhotoName) - 1);
+    g_lastPhotoName[sizeof(g_lastPhotoName) - 1] = '\0';
+    g_monitorEventUploadFlag = 1;
+    log2Val("[UPLOAD] Resume pending transfer at fragment ", x.nextFrag);
+}
+
+// 离线日志队首的事件：由补传调度取出，上传成功后才越过该记录
+struct JournalEvent {
+    bool         ready;
+    PlatformTime t;
+    uint8_t      triggerCond;
+    char         path[64];
+};
+static JournalEvent s_jEvt = {};
+
+// 事件上传状态机：每次 upload_drive 至多推进一步，每步只向发送任务提交一个包（一片），
+// 片间释放链路，心跳/校时等高优先级包可以插在两片之间发出；
+// 准备（打开文件、检查点）与结果处理在主循环，发送在发送任务。
+// 每步带确认窗口分配的序号；各步发完后等平台确认，超时或重连后只补发未确认的片（沿用原序号）
+enum EventJobState : uint8_t { EVT_IDLE = 0, EVT_READY, EVT_QUEUED, EVT_DONE };
+struct EventJob {
+    char         path[64];       // 开始时的 g_lastPhotoName，发送期间有新事件则不清标志
+    bool         fromJournal;    // 离线日志中补传的事件
+    bool         hasImage;
+    size_t       imgLen;
+    bool         hasCrc;
+    uint16_t     imgCrc;
+    PlatformTime t;
+    uint8_t      triggerCond;
+    float        realtimeValue;
+    float        thresholdValue;
+    uint32_t     mismatchBefore;
+    uint16_t     fragCount;      // 0=单包发送
+    uint16_t     frag;           // 当前片
+    uint16_t     startFrag;      // 本次从第几片开始（续传）
+    uint16_t     streamFrag;     // 图片流当前所在片（0xFFFF=未定位）
+    uint8_t      seq;            // 当前一步的上行序号
+    bool         resend;         // 当前一步为补发 resendFrag
+    uint16_t     resendFrag;
+    Crc16Ctx     prefix;         // 已发送各片的图片前缀CRC
+    uint32_t     startMs;
+    uint32_t     sliceStartMs;
+    bool         ok;
+    volatile uint8_t state;
+};
+static EventJob s_evt = {};
+static UploadStats s_upStats;
+
+// 发送任务中执行：发送当前一步（元数据包、单包图片或一片）
+// 前面各片经旁路累加前缀CRC（随检查点保存），有整图CRC时由其反推最后一片的CRC，
+// 最后一片发送时校验，回读不一致则该片以错误CRC结尾，平台无法拼出整图
+static bool event_upload_job(void* ctx) {
+    EventJob& j = *(EventJob*)ctx;
+    const PlatformTime& t = j.t;
+    j.sliceStartMs = millis();
+    if (!j.hasImage) {
+        return sendMonitorEventUpload(
+            t.year, t.month, t.day, t.hour, t.minute, t.second, j.triggerCond,
+            j.realtimeValue, j.thresholdValue, nullptr, 0, j.seq
+        );
+    }
+    if (j.fragCount == 0) {
+        return sendMonitorEventUploadFrom(
+            t.year, t.month, t.day, t.hour, t.minute, t.second, j.triggerCond,
+            j.realtimeValue, j.thresholdValue, photo_stream_source, nullptr, (uint32_t)j.imgLen,
+            j.hasCrc ? &j.imgCrc : nullptr, j.seq
+        );
+    }
+    uint16_t i = j.resend ? j.resendFrag : j.frag;
+    bool last = (i + 1 == j.fragCount);
+    PacketSourceFn src = photo_stream_source;
+    void* srcCtx = nullptr;
+    uint16_t fragCrc = 0;
+    if (!last) {
+        // 补发的片已计入前缀CRC
+        if (!j.resend) {
+            src = photo_crc_tap_source;
+            srcCtx = &j.prefix;
+        }
+    } else if (j.hasCrc) {
+        // crc(前缀||末片) = combine(crc前缀, crc末片, n)，对 crc末片 线性可解
+        uint32_t lastLen = (uint32_t)j.imgLen - (uint32_t)i * PHOTO_FRAG_SIZE;
+        fragCrc = crc16_combine(crc16_final(&j.prefix), 0, lastLen) ^ j.imgCrc;
+    }
+    return sendMonitorEventFragment(
+        t.year, t.month, t.day, t.hour, t.minute, t.second, j.triggerCond,
+        j.realtimeValue, j.thresholdValue, (uint32_t)j.imgLen, i, src, srcCtx,
+        (j.hasCrc && last) ? &fragCrc : nullptr, j.seq);
+}
+
+static void event_upload_done(bool ok, void* ctx) {
+    EventJob& j = *(EventJob*)ctx;
+    uint32_t el = millis() - j.sliceStartMs;
+    if (el > s_upStats.slice_max_ms) s_upStats.slice_max_ms = el;
+    j.ok = ok;
+    ul_ack_on_sent(j.seq, ok);
+    j.state = EVT_DONE;
+}
+
+static uint16_t event_cmd(const EventJob& j) {
+    return j.fragCount ? CMD_EVENT_FRAG_UPLOAD : CMD_EVENT_UPLOAD;
+}
+
+static uint16_t event_steps(const EventJob& j) {
+    return j.fragCount ? j.fragCount : 1;
+}
+
+// 把图片流定位到第 frag 片（补发后回到续传位置时需要重新打开）
+static bool event_seek(EventJob& j, uint16_t frag) {
+    if (!j.hasImage || j.streamFrag == frag) return true;
+    photo_stream_close();
+    j.streamFrag = 0xFFFF;
+    uint32_t sz = 0;
+    if (!photo_stream_open(j.path, (uint32_t)frag * PHOTO_FRAG_SIZE, 0, &sz)) return false;
+    j.streamFrag = frag;
+    return true;
+}
+
+// 提交当前一步（图片流须已定位到该片）：新的一步在确认窗口中登记，补发沿用原序号
+// 窗口满或发送队列满返回 false，状态不变
+static bool submit_event_step() {
+    EventJob& j = s_evt;
+    if (!j.resend) {
+        j.seq = ul_ack_open(event_cmd(j), j.frag);
+        if (!j.seq) return false;
+    }
+    j.ok = false;
+    j.state = EVT_QUEUED;
+    if (dtu_tx_submit_job(TX_PRIO_BULK, event_upload_job, event_upload_done, &j)) {
+        s_upStats.slices++;
+        return true;
+    }
+    if (j.resend) ul_ack_on_sent(j.seq, false);
+    else ul_ack_cancel(event_cmd(j), j.frag);
+    return false;
+}
+
+// 结束本次事件上传（成功或放弃本轮）
+static void end_event_upload(bool success) {
+    EventJob& j = s_evt;
+    j.state = EVT_IDLE;
+    mipsend_upload_end();
+    if (j.hasImage) photo_stream_close();
+    j.streamFrag = 0xFFFF;
+    if (!success) return;
+    if (j.hasImage) {
+        xfer_clear(&s_xfer);
+        s_xferValid = false;
+    }
+    s_upStats.events++;
+    s_upStats.last_event_ms = millis() - j.startMs;
+    if (j.hasImage) {
+        uint32_t sent = (uint32_t)j.imgLen - (uint32_t)j.startFrag * PHOTO_FRAG_SIZE;
+        link_stats_on_upload(sent, s_upStats.last_event_ms);
+    }
+    // 上传一次后清零，等待下一次事件（发送期间拍了新照片则保留标志）
+    if (j.fromJournal) {
+        sd_journal_consume();
+        sd_journal_commit();
+        s_jEvt.ready = false;
+    } else if (strcmp(g_lastPhotoName, j.path) == 0) {
+        g_monitorEventUploadFlag = 0;
+    }
+    s_sidecarMismatch = 0;
+}
+
+// 一步完成后的处理：失败按检查点续传，成功则推进检查点，下一轮再选下一步
+// 末片（或单包）发出后不推进检查点：确认前断链或重启仍从该片续传
+static void on_event_step_done() {
+    EventJob& j = s_evt;
+    uint16_t frag = j.resend ? j.resendFrag : j.frag;
+    bool lastStep = (frag + 1 == event_steps(j));
+    j.streamFrag = j.ok ? frag + 1 : 0xFFFF;
+    if (j.hasImage && (lastStep || !j.ok) &&
+        platform_seg_crc_mismatch_count() != j.mismatchBefore) {
+        // SD回读与写卡时CRC不一致：该包已以错误CRC结尾，下一轮重读重传
+        // 整图不一致无法定位到片，丢弃检查点从头重传
+        s_sidecarMismatch++;
+        xfer_clear(&s_xfer);
+        s_xferValid = false;
+        log2("[UPLOAD] Photo CRC mismatch against sidecar, retry.");
+        end_event_upload(false);
+        return;
+    }
+    if (!j.ok) {
+        if (j.hasImage && !j.resend) {
+            // 读取失败或断链：该包已以错误CRC结尾被平台丢弃，下一轮从检查点续传（不清标志）
+            // 之前已发出、未确认的片仍在确认窗口中，重连后按片补发，不再整片回退
+            xfer_note_attempt(&s_xfer);
+#if XFER_RESUME_REWIND && !UL_ACK_ENABLE
+            xfer_rewind(&s_xfer);
+#endif
+            log2("[UPLOAD] Photo upload interrupted, will resume.");
+        }
+        j.resend = false;
+        end_event_upload(false);
+        return;
+    }
+    j.state = EVT_READY;
+    if (j.resend) {
+        j.resend = false;
+        return;
+    }
+    // 本片已被模组确认：持久化检查点
+    j.frag++;
+    if (!lastStep) xfer_checkpoint(&s_xfer, j.frag, crc16_final(&j.prefix));
+}
+
+// 事件进行中的一步：先补发超时/重连后未确认的片，再发下一片；全部发出后等平台确认
+// 窗口或发送队列满时原地等待下一轮
+static void event_next_step() {
+    EventJob& j = s_evt;
+    if (!comm_isConnected()) {
+        // 断链：关闭文件，重连后从检查点续传
+        end_event_upload(false);
+        return;
+    }
+    uint16_t cmd = event_cmd(j);
+    if (ul_ack_failed(cmd)) {
+        // 某片重传用尽仍未确认：本轮失败，保留检查点与标志，下一轮重新补发该片
+        if (j.hasImage) xfer_note_attempt(&s_xfer);
+        log2("[UPLOAD] Fragment unacknowledged after retries, will retry.");
+        end_event_upload(false);
+        return;
+    }
+    uint16_t tag = 0;
+    uint8_t seq = 0;
+    if (ul_ack_take_due(cmd, &tag, &seq)) {
+        if (!event_seek(j, tag)) {
+            ul_ack_on_sent(seq, false);
+            end_event_upload(false);
+            return;
+        }
+        j.resend = true;
+        j.resendFrag = tag;
+        j.seq = seq;
+        if (!submit_event_step()) j.resend = false;
+        return;
+    }
+    if (j.frag < event_steps(j)) {
+        if (!event_seek(j, j.frag)) {
+            end_event_upload(false);
+            return;
+        }
+        submit_event_step();
+        return;
+    }
+    if (!ul_ack_pending(cmd)) end_event_upload(true);   // 全部确认
+}
+
+// 断链期间的事件记入离线日志并清标志，之后的新事件不再覆盖它；重连后按序补传
+static void journalEventIfNeeded() {
+#if JOURNAL_ENABLE
+    if (g_monitorEventUploadFlag != 1 || !rtc_is_valid()) return;
+    PlatformTime t;
+    if (s_xferValid && strcmp(s_xfer.path, g_lastPhotoName) == 0) t = s_xfer.evtTime;
+    else rtc_now_fields(&t);
+    uint8_t rec[8 + sizeof(g_lastPhotoName)];
+    rec[0] = (uint8_t)(t.year >> 8);
+    rec[1] = (uint8_t)(t.year & 0xFF);
+    rec[2] = t.month;
+    rec[3] = t.day;
+    rec[4] = t.hour;
+    rec[5] = t.minute;
+    rec[6] = t.second;
+    rec[7] = 1;   // 触发条件
+    size_t plen = strnlen(g_lastPhotoName, sizeof(g_lastPhotoName) - 1);
+    memcpy(rec + 8, g_lastPhotoName, plen);
+    if (sd_journal_append(JRNL_EVENT, rec, (uint16_t)(8 + plen))) {
+        log2("[UPLOAD] Offline, event journaled.");
+        g_monitorEventUploadFlag = 0;
+    }
+#endif
 }
 
 static void uploadMonitorEventIfNeeded() {
-    if (!comm_isConnected()) return;
+    if (s_evt.state == EVT_QUEUED) return;
+    if (s_evt.state == EVT_DONE) {
+        on_event_step_done();
+        return;
+    }
+    if (s_evt.state == EVT_READY) {
+        event_next_step();
+        return;
+    }
+    if (!comm_isConnected()) {
+        journalEventIfNeeded();
+        return;
+    }
     if (!rtc_is_valid()) return;
-    if (g_monitorEventUploadFlag != 1) return;
+    // 新事件优先，其次是离线日志中取出的事件
+    bool fromJournal = (g_monitorEventUploadFlag != 1);
+    if (fromJournal && !s_jEvt.ready) return;
+    const char* path = fromJournal ? s_jEvt.path : g_lastPhotoName;
+
+    // 同一张图片有未完成的传输记录：从检查点续传
+    if (s_xferValid && strcmp(s_xfer.path, path) != 0) s_xferValid = false;
+    uint32_t resumeOff = s_xferValid ? (uint32_t)s_xfer.nextFrag * PHOTO_FRAG_SIZE : 0;
 
-    // 读取图片数据
+    // 打开图片文件（不整体读入内存，发送时按块预取）
     size_t imgLen = 0;
-    uint8_t* imageData = read_photo_into_ram(imgLen);
-    if (!imageData && g_cfg.asyncSDWrite) {
-        // 异步未空闲，或读取失败，下一轮再试（不清标志）
+    bool hasCrc = false;
+    uint16_t imgCrc = 0;
+    bool hasImage = open_photo_for_upload(path, resumeOff, imgLen, hasCrc, imgCrc);
+    if (hasImage && s_xferValid && imgLen != s_xfer.imageLen) {
+        // 文件已变化，检查点作废，下一轮从头开始
+        photo_stream_close();
+        xfer_clear(&s_xfer);
+        s_xferValid = false;
+        return;
+    }
+    if (!hasImage && resumeOff && (!g_cfg.asyncSDWrite || sd_async_idle())) {
+        xfer_clear(&s_xfer);
+        s_xferValid = false;
+        return;
+    }
+    if (!hasImage && g_cfg.asyncSDWrite && !(fromJournal && sd_async_idle())) {
+        // 异步未空闲，或读取失败，下一轮再试（不清标志）；日志中的事件图片已不在则只发元数据
         return;
     }
 
     PlatformTime t;
-    rtc_now_fields(&t);
+    if (fromJournal) t = s_jEvt.t;   // 补传沿用事件发生时间
+    else rtc_now_fields(&t);
+    if (hasImage) {
+        if (!s_xferValid) {
+            xfer_begin(&s_xfer, path, (uint32_t)imgLen, &t);
+            s_xferValid = true;
+        } else {
+            t = s_xfer.evtTime;
+            log2Val("[UPLOAD] Resume transfer at fragment ", s_xfer.nextFrag);
+        }
+    } else {
+        log2("[UPLOAD] No image attached (either too large or not ready). Send meta only.");
+    }
+
+    EventJob& j = s_evt;
+    strncpy(j.path, path, sizeof(j.path) - 1);
+    j.path[sizeof(j.path) - 1] = '\0';
+    j.fromJournal = fromJournal;
+    j.hasImage = hasImage;
+    j.imgLen = imgLen;
+    j.hasCrc = hasCrc;
+    j.imgCrc = imgCrc;
+    j.t = t;
+    j.triggerCond = fromJournal ? s_jEvt.triggerCond : 1;
+    j.realtimeValue = 0.0f;
+    j.thresholdValue = 0.0f;
+    j.mismatchBefore = platform_seg_crc_mismatch_count();
+    j.fragCount = (hasImage && imgLen > PHOTO_SINGLE_MAX) ? event_frag_count((uint32_t)imgLen) : 0;
+    j.frag = j.fragCount ? s_xfer.nextFrag : 0;
+    j.startFrag = j.frag;
+    j.streamFrag = hasImage ? j.frag : 0xFFFF;
+    j.resend = false;
+    j.prefix.crc = j.fragCount ? s_xfer.prefixCrc : 0;
+    j.startMs = millis();
+    mipsend_upload_begin();
+    // 该片起已发而未确认的登记作废（将以新序号重发），之前各片仍按确认窗口补发
+    ul_ack_cancel(CMD_EVENT_UPLOAD, 0);
+    ul_ack_cancel(CMD_EVENT_FRAG_UPLOAD, j.frag);
+    ul_ack_rearm(CMD_EVENT_FRAG_UPLOAD);   // 上一轮重传用尽的片重新计次补发
+    j.state = EVT_READY;
+    if (!submit_event_step()) {
+        // 确认窗口或发送队列满：下一轮重新打开
+        end_event_upload(false);
+    }
+}
 
-    uint8_t triggerCond = 1;
-    float realtimeValue = 0.0f;
-    float thresholdValue = 0.0f;
+// 离线日志补传：连接时每 JOURNAL_REPLAY_INTERVAL_MS 开始一批（至多 JOURNAL_REPLAY_BATCH 条）
+// 小包逐条作为发送作业提交，发送任务报告发出（确认开启时为平台确认）后才越过该记录；
+// 发送失败或确认丢失时记录留在队首，下一批重发。事件交给事件上传状态机，完成后才越过该记录
+#if JOURNAL_ENABLE
+enum : uint8_t { JPKT_IDLE = 0, JPKT_QUEUED, JPKT_SENT };
+
+struct JournalPacket {
+    volatile uint8_t state;
+    bool     ok;
+    uint8_t  seq;
+    uint16_t cmd;
+    uint16_t len;
+    uint8_t  payload[DTU_TX_INLINE_MAX];
+};
+static JournalPacket s_jPkt = {};
+static uint32_t s_journalBatchMs = 0;
+static uint8_t  s_journalBatchLeft = 0;
+
+static bool journal_packet_job(void* ctx) {
+    JournalPacket& p = *(JournalPacket*)ctx;
+    PacketSeg seg = { p.payload, p.len, nullptr, nullptr, false, 0 };
+    bool ok = sendPlatformPacketSegs('R', p.cmd, p.seq, &seg, 1);
+    if (ok) link_stats_on_request_sent(p.cmd);
+    return ok;
+}
 
-    if (imageData && imgLen > 0 && imgLen <= 65000) {
-        sendMonitorEventUpload(
-            t.year, t.month, t.day, t.hour, t.minute, t.second, triggerCond,
-            realtimeValue, thresholdValue, imageData, (uint32_t)imgLen
-        );
-        free(imageData);
+static void journal_packet_done(bool ok, void* ctx) {
+    JournalPacket& p = *(JournalPacket*)ctx;
+    p.ok = ok;
+    ul_ack_on_sent(p.seq, ok);
+    p.state = JPKT_SENT;
+}
+
+// 在途记录的结果：已送达则越过；未送达则注销登记，本批结束（记录留在队首）
+// 游标在一批结束时才写入 NVS；返回 false 表示仍在途
+static bool journal_packet_settle() {
+    JournalPacket& p = s_jPkt;
+    if (p.state == JPKT_QUEUED) return false;
+    if (p.state != JPKT_SENT) return true;
+    UlAckSeqState st = p.ok ? ul_ack_seq_state(p.seq) : UL_ACK_SEQ_LOST;
+    if (st == UL_ACK_SEQ_WAIT) return false;
+    p.state = JPKT_IDLE;
+    if (st == UL_ACK_SEQ_DONE) {
+        sd_journal_consume();
     } else {
-        Serial.println("[UPLOAD] No image attached (either too large or not ready). Send meta only.");
-        sendMonitorEventUpload(
-            t.year, t.month, t.day, t.hour, t.minute, t.second, triggerCond,
-            realtimeValue, thresholdValue, nullptr, 0
-        );
+        ul_ack_release(p.seq);
+        s_journalBatchLeft = 0;
     }
+    if (!s_journalBatchLeft) sd_journal_commit();
+    return true;
+}
+
+// 提交队首小包；确认窗口或发送队列满返回 false
+static bool journal_packet_submit(uint16_t cmd, const uint8_t* payload, uint16_t len) {
+    JournalPacket& p = s_jPkt;
+    if (len > sizeof(p.payload)) return false;
+    p.seq = ul_ack_open(cmd, 0);
+    if (!p.seq) return false;
+    p.cmd = cmd;
+    p.len = len;
+    memcpy(p.payload, payload, len);
+    p.ok = false;
+    p.state = JPKT_QUEUED;
+    if (dtu_tx_submit_job(TX_PRIO_NORMAL, journal_packet_job, journal_packet_done, &p)) return true;
+    p.state = JPKT_IDLE;
+    ul_ack_release(p.seq);
+    return false;
+}
+#endif
+
+static void replayJournalIfNeeded(uint32_t now) {
+#if JOURNAL_ENABLE
+    if (s_jEvt.ready) return;   // 队首事件上传中
+    if (!journal_packet_settle()) return;   // 队首小包在途
+    if (!comm_isConnected() || !sd_journal_pending()) return;
+    if (s_journalBatchLeft == 0) {
+        if (now - s_journalBatchMs < JOURNAL_REPLAY_INTERVAL_MS) return;
+        s_journalBatchMs = now;
+        s_journalBatchLeft = JOURNAL_REPLAY_BATCH;
+    }
+
+    uint8_t buf[JRNL_DATA_MAX];
+    uint8_t type = 0;
+    uint16_t len = 0;
+    while (s_journalBatchLeft) {
+        if (!sd_journal_peek(&type, buf, &len)) break;
+        s_journalBatchLeft--;
+        if (type == JRNL_PACKET && len >= 2) {
+            uint16_t cmd = ((uint16_t)buf[0] << 8) | buf[1];
+            if (!journal_packet_submit(cmd, buf + 2, len - 2)) {
+                s_journalBatchLeft = 0;
+                sd_journal_commit();
+            }
+            return;   // 送达后才越过
+        } else if (type == JRNL_EVENT && len >= 8) {
+            JournalEvent& e = s_jEvt;
+            e.t.year = ((uint16_t)buf[0] << 8) | buf[1];
+            e.t.month = buf[2];
+            e.t.day = buf[3];
+            e.t.hour = buf[4];
+            e.t.minute = buf[5];
+            e.t.second = buf[6];
+            e.triggerCond = buf[7];
+            size_t plen = len - 8;
+            if (plen > sizeof(e.path) - 1) plen = sizeof(e.path) - 1;
+            memcpy(e.path, buf + 8, plen);
+            e.path[plen] = '\0';
+            e.ready = true;
+            s_journalBatchLeft = 0;
+            break;
+        }
+        // 无法识别的记录：越过
+        sd_journal_consume();
+    }
+    s_journalBatchLeft = 0;
+    sd_journal_commit();
+#else
+    (void)now;
+#endif
+}
 
-    // 上传一次后清零，等待下一次事件
-    g_monitorEventUploadFlag = 0;
+void upload_get_stats(UploadStats& out) {
+    out = s_upStats;
 }
 
 void upload_drive() {
+    uint32_t t0 = micros();
     uint32_t now = millis();
+    ul_ack_poll(now);                  // 上行确认超时与补发
     uploadStartupStatusIfNeeded();     // 开机状态上报
     uploadSimInfoIfNeeded();           // SIM卡状态上报
     uploadRealtimeDataIfNeeded(now);   // 实时数据上报
-    uploadMonitorEventIfNeeded();      // 事件图片上传
+    uploadMonitorEventIfNeeded();      // 事件图片上传（每轮至多一步）
+    uploadLinkStatsIfNeeded(now);      // 链路统计窗口上报
+    replayJournalIfNeeded(now);        // 离线日志补传
+    // 调度本身的耗时（不含拍照）
+    uint32_t us = micros() - t0;
+    s_upStats.ticks++;
+    s_upStats.tick_last_us = us;
+    if (us > s_upStats.tick_max_us) s_upStats.tick_max_us = us;
+    if (us > UPLOAD_TICK_BUDGET_US) s_upStats.tick_over_budget++;
     water_auto_capture_upload_if_needed(now); // 持续按住10分钟周期拍照
 }
\ No newline at end of file
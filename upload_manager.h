@@ -3,4 +3,21 @@
 #include "sim_info.h"
 
 // 上传调度（与业务相关：实时数据、事件等）
-void upload_drive();
\ No newline at end of file
+void upload_drive();
+
+// 开机时恢复NVS中未完成的事件图片传输（需在SD挂载后调用），恢复后由 upload_drive 续传
+void upload_restore_pending();
+
+// 上传调度统计：tick 为每次 upload_drive 的调度耗时（不含周期拍照），slice 为发送任务中单步（一个包）的耗时
+struct UploadStats {
+    uint32_t ticks = 0;
+    uint32_t tick_last_us = 0;
+    uint32_t tick_max_us = 0;
+    uint32_t tick_over_budget = 0;  // 超过 UPLOAD_TICK_BUDGET_US 的次数
+    uint32_t slices = 0;            // 提交的事件发送步数
+    uint32_t slice_max_ms = 0;
+    uint32_t events = 0;            // 完成的事件上传
+    uint32_t last_event_ms = 0;     // 最近一次事件从开始到完成的耗时
+};
+
+void upload_get_stats(UploadStats& out);
@@ -0,0 +1,83 @@
+#include "upload_xfer.h"
+#include "config.h"
+#include "crc16.h"
+#include <Preferences.h>
+
+#define XFER_NVS_NS   "xfer"
+#define XFER_NVS_KEY  "cur"
+#define XFER_MAGIC    0x58465231UL  // "XFR1"
+
+// NVS 中的存储格式：记录 + magic + 自校验
+typedef struct {
+    uint32_t   magic;
+    UploadXfer x;
+    uint16_t   crc;
+} XferRecord;
+
+static void xfer_store(const UploadXfer* x) {
+    XferRecord r;
+    memset(&r, 0, sizeof(r));
+    r.magic = XFER_MAGIC;
+    r.x = *x;
+    r.crc = crc16_modbus((const uint8_t*)&r, offsetof(XferRecord, crc));
+
+    Preferences p;
+    if (!p.begin(XFER_NVS_NS, false)) return;
+    p.putBytes(XFER_NVS_KEY, &r, sizeof(r));
+    p.end();
+}
+
+bool xfer_load(UploadXfer* x) {
+    Preferences p;
+    if (!p.begin(XFER_NVS_NS, true)) return false;
+    XferRecord r;
+    size_t n = p.getBytes(XFER_NVS_KEY, &r, sizeof(r));
+    p.end();
+    if (n != sizeof(r)) return false;
+    if (r.magic != XFER_MAGIC) return false;
+    if (r.crc != crc16_modbus((const uint8_t*)&r, offsetof(XferRecord, crc))) return false;
+    r.x.path[sizeof(r.x.path) - 1] = '\0';
+    *x = r.x;
+    return true;
+}
+
+void xfer_begin(UploadXfer* x, const char* path, uint32_t imageLen, const PlatformTime* t) {
+    memset(x, 0, sizeof(*x));
+    strncpy(x->path, path, sizeof(x->path) - 1);
+    x->imageLen = imageLen;
+    Crc16Ctx c;
+    crc16_init(&c);
+    x->prefixCrc = x->prevCrc = crc16_final(&c);
+    x->evtTime = *t;
+    xfer_store(x);
+}
+
+void xfer_checkpoint(UploadXfer* x, uint16_t nextFrag, uint16_t prefixCrc) {
+    x->prevCrc = x->prefixCrc;
+    x->canRewind = 1;
+    x->nextFrag = nextFrag;
+    x->prefixCrc = prefixCrc;
+    xfer_store(x);
+}
+
+void xfer_rewind(UploadXfer* x) {
+    // 只保存了一级前缀CRC，最多回退一片，且两次回退之间须有新的分片确认
+    if (x->nextFrag == 0 || !x->canRewind) return;
+    x->nextFrag--;
+    x->prefixCrc = x->prevCrc;
+    x->canRewind = 0;
+    xfer_store(x);
+}
+
+void xfer_note_attempt(UploadXfer* x) {
+    if (x->attempts < 0xFF) x->attempts++;
+    xfer_store(x);
+}
+
+void xfer_clear(UploadXfer* x) {
+    memset(x, 0, sizeof(*x));
+    Preferences p;
+    if (!p.begin(XFER_NVS_NS, false)) return;
+    p.remove(XFER_NVS_KEY);
+    p.end();
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <Arduino.h>
+#include "uart_utils.h"
+
+// 事件图片传输记录：持久化到NVS，断链/重启后从检查点续传而不是从头重发
+// 检查点只在某一片被模组确认（mipsend_end 成功）后推进
+typedef struct {
+    char         path[64];   // 图片文件名（与 g_lastPhotoName 一致）
+    uint32_t     imageLen;   // 整图长度
+    uint16_t     nextFrag;   // 下一个待发送分片
+    uint16_t     prefixCrc;  // 前 nextFrag 片图片数据的CRC（续传后仍可校验旁路记录）
+    uint16_t     prevCrc;    // 前 nextFrag-1 片的CRC（回退一片续传时使用）
+    uint8_t      canRewind;  // prevCrc 有效（上次回退后又有分片确认）
+    PlatformTime evtTime;    // 事件时间：续传的各片与首片保持一致，平台据此拼图
+    uint8_t      attempts;   // 已尝试次数（含重启前）
+} UploadXfer;
+
+// 读取未完成的传输记录；无记录或记录损坏返回 false
+bool xfer_load(UploadXfer* x);
+
+// 开始新传输（覆盖旧记录）并立即落盘
+void xfer_begin(UploadXfer* x, const char* path, uint32_t imageLen, const PlatformTime* t);
+
+// 第 nextFrag-1 片已确认：推进检查点
+void xfer_checkpoint(UploadXfer* x, uint16_t nextFrag, uint16_t prefixCrc);
+
+// 回退一片（模组已确认但可能仍在其TCP缓冲中、随断链丢失的分片），平台按 offset 去重
+void xfer_rewind(UploadXfer* x);
+
+// 记录一次失败的尝试
+void xfer_note_attempt(UploadXfer* x);
+
+// 传输完成或放弃：删除记录
+void xfer_clear(UploadXfer* x);